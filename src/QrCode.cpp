@@ -3,6 +3,8 @@
 #include <string>
 #include <fstream>
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <regex>
 #include <filesystem>
 #include <stdint.h>
@@ -16,6 +18,7 @@
 #include <ZXing/ReadBarcode.h>
 #include "QrCode.h"
 #include "favicon.hpp"
+#include "schedule.hpp"
 #include "type_mgk.h"
 #include "jbigkit/jbig.h"
 
@@ -66,6 +69,21 @@ namespace qr
       }
     }
 
+    // set the number of threads used by graphicsmagick (OpenMP team size)
+    //  the team size is a setting of each thread: it is applied by the threads which render
+    static void SetThreads(const std::size_t nb_threads)
+    {
+      Initialize();
+      m_threads.set(std::max<std::size_t>(1, nb_threads));
+      m_threads.apply();
+    }
+
+    // apply the number of graphicsmagick threads to the calling thread
+    static void ApplyThreads()
+    {
+      m_threads.apply();
+    }
+
     // convert from std::string to Magick::Color
     static Magick::Color GetColor(const std::string& color)
     {
@@ -79,6 +97,15 @@ namespace qr
       }
     }
 
+    // create a deep copy of an image - images aren't shared between threads
+    static Magick::Image Clone(const Magick::Image& img)
+    {
+      Magick::Image copy(img);
+      if (copy.isValid())
+        copy.modifyImage();
+      return copy;
+    }
+
     // convert the data from Magick::Image to std::string buffer
     static std::string ToString(const Magick::Image& img)
     {
@@ -93,9 +120,13 @@ namespace qr
   private:
     static bool m_initialized;
     static std::mutex m_mutex;
+    static schedule::thread_limit m_threads;
   };
   bool GraphicsMagick::m_initialized = false;
   std::mutex GraphicsMagick::m_mutex;
+  schedule::thread_limit GraphicsMagick::m_threads([](const std::size_t nb_threads) {
+    MagickLib::SetMagickResourceLimit(MagickLib::ThreadsResource, static_cast<MagickLib::magick_int64_t>(nb_threads));
+    });
 
   // implementation of the QR Code functionnalities
   class QrCodeImpl final
@@ -124,6 +155,9 @@ namespace qr
     // generate png image of qrcode in std::string
     const struct PngImage get() const
     {
+      // limit the graphicsmagick threads of the calling thread - worker or timeout thread
+      GraphicsMagick::ApplyThreads();
+
       // create QR Code using qrcodegen library
       const std::string& qrcode_data = m_options.getArg<std::string>(details::option_id::qrcode_data);
       const qr::ecc& qrcode_ecc = m_options.getArg<qr::ecc>(details::option_id::qrcode_ecc);
@@ -144,10 +178,38 @@ namespace qr
       const Magick::Image& frame = get_frame_png(qrcode.columns(), qrcode.rows());
       const Magick::Image& text = get_text_png(frame.columns());
 
-      // assemble all png images with logo - try to decode with ZXing
+      // assemble all png images without logo - try to decode with ZXing
+      //  returns an empty image if cancelled or not decoded properly
       const std::string& title = m_options.getArg<std::string>(details::option_id::qrcode_title);
       const std::size_t frame_border_width_size = m_options.getArg<std::size_t>(details::option_id::frame_border_width_size);
       const std::size_t frame_border_height_size = title.empty() ? 0 : m_options.getArg<std::size_t>(details::option_id::frame_border_height_size);
+      std::atomic<bool> cancelled(false);
+      auto get_without_logo = [&](const Magick::Image& frame_png, const Magick::Image& qrcode_png, const Magick::Image& text_png) -> struct PngImage {
+        if (cancelled)
+          return {};
+        Magick::Image without_logo(Magick::Geometry(frame_png.columns(), frame_png.rows()), Magick::Color("transparent"));
+        without_logo.composite(frame_png, 0, 0, MagickLib::OverCompositeOp);
+        without_logo.composite(qrcode_png, frame_border_width_size, frame_border_width_size, MagickLib::OverCompositeOp);
+        without_logo.composite(text_png, (frame_png.columns() - text_png.columns()) / 2, frame_border_width_size + qrcode_png.rows() + (frame_border_height_size - text_png.rows()) / 2, MagickLib::OverCompositeOp);
+        if (cancelled)
+          return {};
+        without_logo.magick("PNG");
+        if (decode_qr_code(without_logo, &cancelled) != qrcode_data)
+          return {};
+        return { without_logo.columns(), without_logo.rows(), GraphicsMagick::ToString(without_logo) };
+      };
+
+      // speculative mode: assemble the image without logo in parallel on copies of the images
+      //  it is cancelled if the image with logo is decoded properly - checked between the render and the decode
+      //  as the future waits for the variant when it is discarded
+      std::future<struct PngImage> speculative;
+      if (logo.isValid() && m_options.getArg<bool>(details::option_id::frame_logo_speculative))
+        speculative = std::async(std::launch::async, [&, frame_png = GraphicsMagick::Clone(frame), qrcode_png = GraphicsMagick::Clone(qrcode), text_png = GraphicsMagick::Clone(text)]() {
+          GraphicsMagick::ApplyThreads();
+          return get_without_logo(frame_png, qrcode_png, text_png);
+          });
+
+      // assemble all png images with logo - try to decode with ZXing
       if (logo.isValid())
       {
         Magick::Image with_logo(Magick::Geometry(frame.columns(), frame.rows()), Magick::Color("transparent"));
@@ -157,20 +219,17 @@ namespace qr
         with_logo.composite(text, (frame.columns() - text.columns()) / 2, frame_border_width_size + qrcode.rows() + (frame_border_height_size - text.rows()) / 2, MagickLib::OverCompositeOp);
         with_logo.magick("PNG");
         if (decode_qr_code(with_logo) == qrcode_data)
+        {
+          cancelled = true;
           return { with_logo.columns(), with_logo.rows(), GraphicsMagick::ToString(with_logo) };
+        }
       }
-      // assemble all png images without logo - try to decode with ZXing
-      {
-        Magick::Image without_logo(Magick::Geometry(frame.columns(), frame.rows()), Magick::Color("transparent"));
-        without_logo.composite(frame, 0, 0, MagickLib::OverCompositeOp);
-        without_logo.composite(qrcode, frame_border_width_size, frame_border_width_size, MagickLib::OverCompositeOp);
-        without_logo.composite(text, (frame.columns() - text.columns()) / 2, frame_border_width_size + qrcode.rows() + (frame_border_height_size - text.rows()) / 2, MagickLib::OverCompositeOp);
-        without_logo.magick("PNG");
-        if (decode_qr_code(without_logo) == qrcode_data)
-          return { without_logo.columns(), without_logo.rows(), GraphicsMagick::ToString(without_logo) };
-        else
-          throw std::runtime_error("can't decode QR Code image properly using ZXing");
-      }
+
+      // fallback to the image without logo
+      const struct PngImage& png = speculative.valid() ? speculative.get() : get_without_logo(frame, qrcode, text);
+      if (png.data.empty())
+        throw std::runtime_error("can't decode QR Code image properly using ZXing");
+      return png;
     }
 
   private:
@@ -233,11 +292,16 @@ namespace qr
         if (url.empty() || !logo_size)
           return {};
 
-        // download the logo - using google-api or favicon otherwise
+        // use the prefetched logo if given (empty if not available)
+        //  download the logo otherwise - using google-api or favicon otherwise
         std::string icon_content;
-        if (!favicon::download_with_google_api(url, logo_size, icon_content))
+        if (m_options.hasArg(details::option_id::qrcode_logo))
+          icon_content = m_options.getArg<std::string>(details::option_id::qrcode_logo);
+        else if (!favicon::download_with_google_api(url, logo_size, icon_content))
           if (!favicon::download_with_generic_api(url, logo_size, icon_content))
             return {};
+        if (icon_content.empty())
+          return {};
 
         // load the favicon data and resize it
         Magick::Blob blob_in(icon_content.c_str(), icon_content.size());
@@ -344,8 +408,8 @@ namespace qr
       return frame;
     }
 
-    // try to decode the QR Code with ZXing
-    const std::string decode_qr_code(const Magick::Image& img) const
+    // try to decode the QR Code with ZXing - skipped if cancelled once the pixels are read
+    const std::string decode_qr_code(const Magick::Image& img, const std::atomic<bool>* cancelled = nullptr) const
     {
       try
       {
@@ -355,6 +419,8 @@ namespace qr
         std::vector<unsigned char> data(3.0 * width * height, 0);
         Magick::Image& i = const_cast<Magick::Image&>(img);
         i.write(0, 0, width, height, "RGB", Magick::CharPixel, &data[0]);
+        if (cancelled && *cancelled)
+          return {};
 
         // decode QR Code using ZXing library
         ZXing::DecodeHints hints;
@@ -381,4 +447,5 @@ namespace qr
   QrCode::~QrCode() = default;
   void QrCode::set(const std::initializer_list<details::OptionsVal>& opts) { if (m_pimpl) m_pimpl->set(opts); }
   const struct PngImage QrCode::get() const { return m_pimpl ? m_pimpl->get() : struct PngImage(); }
+  void set_magick_threads(const std::size_t nb_threads) { GraphicsMagick::SetThreads(nb_threads); }
 }
\ No newline at end of file
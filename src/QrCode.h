@@ -13,6 +13,10 @@ namespace qr
     std::string data;
   };
 
+  // set the number of threads used by graphicsmagick to process each image
+  //  applied by each thread when it creates a QR Code
+  void set_magick_threads(const std::size_t nb_threads);
+
   class QrCodeImpl;
   class QrCode final
   {
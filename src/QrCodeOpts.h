@@ -2,6 +2,7 @@
 #include <map>
 #include <algorithm>
 #include <string>
+#include <vector>
 #include <variant>
 #include <initializer_list>
 #include <stdint.h>
@@ -26,6 +27,7 @@ namespace details
     qrcode_title,
     qrcode_data,
     qrcode_url,
+    qrcode_logo,
     qrcode_ecc,
     qrcode_module_px_size,
     qrcode_border_px_size,
@@ -38,13 +40,15 @@ namespace details
     frame_logo_size,
     frame_font_family,
     frame_font_color,
-    frame_font_size
+    frame_font_size,
+    frame_logo_speculative
   };
   const std::map<option_id, std::string> option_name = 
   {
     {option_id::qrcode_title,             "qrcode-title"},
     {option_id::qrcode_data,              "qrcode-data"},
     {option_id::qrcode_url,               "qrcode-url"},
+    {option_id::qrcode_logo,              "qrcode-logo"},
     {option_id::qrcode_ecc,               "qrcode-ecc"},
     {option_id::qrcode_module_px_size,    "qrcode-module-px-size"},
     {option_id::qrcode_border_px_size,    "qrcode-border-px-size"},
@@ -57,7 +61,8 @@ namespace details
     {option_id::frame_logo_size,          "frame-logo-size"},
     {option_id::frame_font_family,        "frame-font-family"},
     {option_id::frame_font_color,         "frame-font-color"},
-    {option_id::frame_font_size,          "frame-font-size"}
+    {option_id::frame_font_size,          "frame-font-size"},
+    {option_id::frame_logo_speculative,   "frame-logo-speculative"}
   };
 
   // template used to check the data type validity
@@ -71,7 +76,6 @@ namespace details
     {
       static_assert(std::is_convertible_v<T1, T2>, "invalid data type for this option");
     }
-    template<>
     option_data(const char* a) :
       id(ID),
       arg(a)
@@ -89,6 +93,7 @@ namespace option
   using qrcode_title              = details::option_data<details::option_id::qrcode_title,              std::string>;
   using qrcode_data               = details::option_data<details::option_id::qrcode_data,               std::string>;
   using qrcode_url                = details::option_data<details::option_id::qrcode_url,                std::string>;
+  using qrcode_logo               = details::option_data<details::option_id::qrcode_logo,               std::string>;
   using qrcode_ecc                = details::option_data<details::option_id::qrcode_ecc,                qr::ecc>;
   using qrcode_module_px_size     = details::option_data<details::option_id::qrcode_module_px_size,     std::size_t>;
   using qrcode_border_px_size     = details::option_data<details::option_id::qrcode_border_px_size,     std::size_t>;
@@ -102,6 +107,7 @@ namespace option
   using frame_font_family         = details::option_data<details::option_id::frame_font_family,         std::string>;
   using frame_font_color          = details::option_data<details::option_id::frame_font_color,          std::string>;
   using frame_font_size           = details::option_data<details::option_id::frame_font_size,           double>;
+  using frame_logo_speculative    = details::option_data<details::option_id::frame_logo_speculative,    bool>;
 }
 
 namespace details
@@ -112,6 +118,7 @@ namespace details
       option::qrcode_title,
       option::qrcode_data,
       option::qrcode_url,
+      option::qrcode_logo,
       option::qrcode_ecc,
       option::qrcode_module_px_size,
       option::qrcode_border_px_size,
@@ -124,11 +131,12 @@ namespace details
       option::frame_logo_size,
       option::frame_font_family,
       option::frame_font_color,
-      option::frame_font_size
+      option::frame_font_size,
+      option::frame_logo_speculative
     >;
 
   // variant which contains all the different options data types
-  using OptionsType = std::variant<std::string, std::size_t, double, qr::ecc>;
+  using OptionsType = std::variant<std::string, std::size_t, double, qr::ecc, bool>;
 
   // store all the different options
   class Options final
@@ -149,6 +157,7 @@ namespace details
         if      (std::holds_alternative<option::qrcode_title>(o))             setArg(option_id::qrcode_title,             std::get<option::qrcode_title>(o).arg);
         else if (std::holds_alternative<option::qrcode_data>(o))              setArg(option_id::qrcode_data,              std::get<option::qrcode_data>(o).arg);
         else if (std::holds_alternative<option::qrcode_url>(o))               setArg(option_id::qrcode_url,               std::get<option::qrcode_url>(o).arg);
+        else if (std::holds_alternative<option::qrcode_logo>(o))              setArg(option_id::qrcode_logo,              std::get<option::qrcode_logo>(o).arg);
         else if (std::holds_alternative<option::qrcode_ecc>(o))               setArg(option_id::qrcode_ecc,               std::get<option::qrcode_ecc>(o).arg);
         else if (std::holds_alternative<option::qrcode_module_px_size>(o))    setArg(option_id::qrcode_module_px_size,    std::get<option::qrcode_module_px_size>(o).arg);
         else if (std::holds_alternative<option::qrcode_border_px_size>(o))    setArg(option_id::qrcode_border_px_size,    std::get<option::qrcode_border_px_size>(o).arg);
@@ -162,6 +171,7 @@ namespace details
         else if (std::holds_alternative<option::frame_font_family>(o))        setArg(option_id::frame_font_family,        std::get<option::frame_font_family>(o).arg);
         else if (std::holds_alternative<option::frame_font_color>(o))         setArg(option_id::frame_font_color,         std::get<option::frame_font_color>(o).arg);
         else if (std::holds_alternative<option::frame_font_size>(o))          setArg(option_id::frame_font_size,          std::get<option::frame_font_size>(o).arg);
+        else if (std::holds_alternative<option::frame_logo_speculative>(o))   setArg(option_id::frame_logo_speculative,   std::get<option::frame_logo_speculative>(o).arg);
         else throw std::runtime_error("invalid option given");
       }
     }
@@ -180,8 +190,13 @@ namespace details
     bool hasArg(const option_id id) const { return (m_opts.find(id) != m_opts.end()); }
 
     // check if the options have been set
+    bool hasArgs(const std::vector<option_id>& ids) const
+    {
+      std::vector<option_id> missing_ids;
+      return hasArgs(ids, missing_ids);
+    }
     bool hasArgs(const std::vector<option_id>& ids,
-                 std::vector<option_id>& missing_ids = std::vector<option_id>()) const
+                 std::vector<option_id>& missing_ids) const
     {
       std::for_each(ids.begin(), ids.end(), [&](const option_id id) {
         if (!hasArg(id))
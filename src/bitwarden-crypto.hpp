@@ -0,0 +1,219 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+#include "openssl-base64.hpp"
+#include "openssl-kdf.hpp"
+#include "bitwarden-reader.hpp"
+
+namespace bitwarden
+{
+  // symmetric key used by bitwarden to encrypt strings: AES-256-CBC + HMAC-SHA256
+  struct symmetric_key
+  {
+    std::vector<unsigned char> enc;
+    std::vector<unsigned char> mac;
+  };
+
+  namespace details
+  {
+    // read a boolean flag of the root object
+    inline bool get_flag(const json& root, const std::string& name)
+    {
+      return root.is_object() &&
+             root.contains(name) &&
+             root[name].is_boolean() &&
+             root[name].get<bool>();
+    }
+
+    // read a number of the root object
+    inline std::size_t get_number(const json& root, const std::string& name, const std::size_t default_value)
+    {
+      if (!root.contains(name) || !root[name].is_number_unsigned())
+        return default_value;
+      return root[name].get<std::size_t>();
+    }
+  }
+
+  // check if the export is encrypted with the password of the export
+  //  the whole vault is stored as a single encrypted string in "data"
+  inline bool is_password_protected(const json& root)
+  {
+    return details::get_flag(root, "encrypted") && details::get_flag(root, "passwordProtected");
+  }
+
+  // check if the export is restricted to the account
+  //  every string of the items is encrypted with the account symmetric key
+  inline bool is_account_restricted(const json& root)
+  {
+    return details::get_flag(root, "encrypted") && !details::get_flag(root, "passwordProtected");
+  }
+
+  // decrypt a bitwarden encrypted string of type 2: "2.<iv b64>|<data b64>|<mac b64>"
+  inline std::string decrypt(const std::string& enc_string, const struct symmetric_key& key)
+  {
+    // split the encrypted string
+    if (enc_string.rfind("2.", 0) != 0)
+      throw std::runtime_error("unsupported bitwarden encrypted string type");
+    const std::size_t p1 = enc_string.find('|', 2);
+    const std::size_t p2 = (p1 == std::string::npos) ? p1 : enc_string.find('|', p1 + 1);
+    if (p2 == std::string::npos)
+      throw std::runtime_error("invalid bitwarden encrypted string");
+    const std::vector<unsigned char>& iv = base64::decode(enc_string.substr(2, p1 - 2));
+    const std::vector<unsigned char>& data = base64::decode(enc_string.substr(p1 + 1, p2 - p1 - 1));
+    const std::vector<unsigned char>& mac = base64::decode(enc_string.substr(p2 + 1));
+    if ((iv.size() != 16) || (mac.size() != SHA256_DIGEST_LENGTH) || data.empty())
+      throw std::runtime_error("invalid bitwarden encrypted string");
+
+    // check the authentication code: HMAC-SHA256(iv | data)
+    std::vector<unsigned char> msg(iv);
+    msg.insert(msg.end(), data.begin(), data.end());
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    if (!HMAC(EVP_sha256(), key.mac.data(), static_cast<int>(key.mac.size()), msg.data(), msg.size(), digest, &len) ||
+        (len != mac.size()) ||
+        (CRYPTO_memcmp(digest, mac.data(), len) != 0))
+      throw std::runtime_error("invalid bitwarden encrypted string authentication code - wrong key?");
+
+    // decrypt data using aes-256-cbc algorithm with PKCS#7 padding
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx)
+      throw std::runtime_error("can't initialize the openssl cipher context");
+    std::string plain(data.size() + 16, 0);
+    int plain_len = 0;
+    int final_len = 0;
+    const bool ok =
+      (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.enc.data(), iv.data()) == 1) &&
+      (EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char*>(plain.data()), &plain_len, data.data(), static_cast<int>(data.size())) == 1) &&
+      (EVP_DecryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(plain.data()) + plain_len, &final_len) == 1);
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok)
+      throw std::runtime_error("can't decrypt bitwarden encrypted string");
+    plain.resize(static_cast<std::size_t>(plain_len) + final_len);
+    return plain;
+  }
+
+  // create a symmetric key from a base64 encoded 64 bytes key (encryption key | mac key)
+  inline const struct symmetric_key get_symmetric_key(const std::string& key_b64)
+  {
+    const std::vector<unsigned char>& key = base64::decode(key_b64);
+    if (key.size() != 64)
+      throw std::runtime_error(fmt::format("invalid bitwarden symmetric key size: {} (should be 64)", key.size()));
+    return { { key.begin(), key.begin() + 32 }, { key.begin() + 32, key.end() } };
+  }
+
+  // derive the key of a password protected export using its kdf settings
+  //  kdfType: 0 = PBKDF2-SHA256, 1 = Argon2id (salt hashed with SHA-256, memory in MiB)
+  inline const struct symmetric_key derive_export_key(const json& root, const std::string& password)
+  {
+    if (password.empty())
+      throw std::runtime_error("the bitwarden json file is password protected: missing --export-password");
+    if (!root.contains("salt") || !root["salt"].is_string() ||
+        !root.contains("kdfType") || !root["kdfType"].is_number_unsigned() ||
+        !root.contains("kdfIterations") || !root["kdfIterations"].is_number_unsigned() ||
+        !root.contains("data") || !root["data"].is_string())
+      throw std::runtime_error("invalid password protected json file format");
+    const std::string& salt = root["salt"].get<std::string>();
+    const std::size_t iterations = root["kdfIterations"].get<std::size_t>();
+
+    // derive the master key
+    std::vector<unsigned char> master_key;
+    switch (root["kdfType"].get<int>())
+    {
+    case 0:
+      master_key = kdf::pbkdf2_sha256(password, { salt.begin(), salt.end() }, iterations, 32);
+      break;
+    case 1:
+    {
+      std::vector<unsigned char> salt_hash(SHA256_DIGEST_LENGTH, 0);
+      SHA256(reinterpret_cast<const unsigned char*>(salt.data()), salt.size(), salt_hash.data());
+      const std::size_t memory = details::get_number(root, "kdfMemory", 64);
+      const std::size_t parallelism = details::get_number(root, "kdfParallelism", 4);
+      master_key = kdf::argon2id(password, salt_hash, iterations, memory * 1024, parallelism, 32);
+      break;
+    }
+    default:
+      throw std::runtime_error(fmt::format("unsupported bitwarden kdf type: {}", root["kdfType"].dump()));
+    }
+
+    // stretch the master key into the encryption and mac keys
+    const struct symmetric_key key = {
+      kdf::hkdf_expand_sha256(master_key, "enc", 32),
+      kdf::hkdf_expand_sha256(master_key, "mac", 32)
+    };
+    OPENSSL_cleanse(master_key.data(), master_key.size());
+    return key;
+  }
+
+  // check that the key is able to decrypt the validation string of the export
+  inline void check_key(const json& root, const struct symmetric_key& key)
+  {
+    if (root.contains("encKeyValidation_DO_NOT_EDIT") && root["encKeyValidation_DO_NOT_EDIT"].is_string())
+      decrypt(root["encKeyValidation_DO_NOT_EDIT"].get<std::string>(), key);
+  }
+
+  // decrypt all the strings of the items of an account restricted export
+  //  the items are independent: they are decrypted in parallel
+  inline void decrypt_items(std::vector<struct item>& items,
+                            const struct symmetric_key& key,
+                            const std::size_t nb_threads)
+  {
+    // decrypt one string in place
+    auto decrypt_string = [&](std::string& str) {
+      if (!str.empty())
+        str = decrypt(str, key);
+    };
+
+    // take items using an atomic index - keep the first failure
+    std::atomic<std::size_t> next(0);
+    std::mutex mutex;
+    std::string failure;
+    auto decrypt_worker = [&]() {
+      for (std::size_t i = next++; i < items.size(); i = next++)
+      {
+        try
+        {
+          struct item& item = items[i];
+          decrypt_string(item.name);
+          decrypt_string(item.username);
+          decrypt_string(item.password);
+          decrypt_string(item.totp);
+          decrypt_string(item.uri);
+          for (auto& field : item.fields)
+          {
+            decrypt_string(field.name);
+            decrypt_string(field.value);
+          }
+        }
+        catch (const std::exception& ex)
+        {
+          std::lock_guard<std::mutex> lck(mutex);
+          if (failure.empty())
+            failure = ex.what();
+          next = items.size();
+        }
+      }
+    };
+
+    // start threads and wait for their completion
+    std::vector<std::thread> threads(std::max<std::size_t>(1, std::min(nb_threads, items.size())));
+    for (auto& t : threads)
+      t = std::thread(decrypt_worker);
+    for (auto& t : threads)
+      if (t.joinable())
+        t.join();
+    if (!failure.empty())
+      throw std::runtime_error(failure);
+  }
+}
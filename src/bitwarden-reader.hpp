@@ -0,0 +1,407 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <string_view>
+#include <stdexcept>
+#include <functional>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#ifdef BW2QR_WITH_SIMDJSON
+#include <simdjson.h>
+#endif
+
+namespace bitwarden
+{
+  using json = nlohmann::ordered_json;
+
+  // json parser used to read the bitwarden export
+  enum class backend
+  {
+    nlohmann, // streaming SAX parser
+    simdjson  // SIMD on-demand parser (if built with BW2QR_WITH_SIMDJSON)
+  };
+
+  // convert the name of a json parser into a backend
+  inline backend get_backend(const std::string& name)
+  {
+    if (name == "nlohmann")
+      return backend::nlohmann;
+    if (name == "simdjson")
+    {
+#ifdef BW2QR_WITH_SIMDJSON
+      return backend::simdjson;
+#else
+      throw std::runtime_error("simdjson json parser isn't available in this build");
+#endif
+    }
+    throw std::runtime_error(fmt::format("invalid json parser: \"{}\"", name));
+  }
+
+  // custom field of an item
+  struct field
+  {
+    std::string name;
+    std::string value;
+  };
+
+  // properties of a bitwarden item used to create a QR Code
+  struct item
+  {
+    std::string name;
+    int type = 0;
+    bool favorite = false;
+    std::string folder_id;
+    std::string organization_id;
+    std::vector<std::string> collection_ids;
+    std::string username;
+    std::string password;
+    std::string totp;
+    std::string uri;
+    std::vector<struct field> fields;
+  };
+
+  // select the items to keep - called before reading their login data
+  using selector = std::function<bool(const struct item&)>;
+
+  // called for every selected item
+  using item_handler = std::function<void(struct item&&)>;
+
+  // called with the root object (without the items) when the "items" array starts
+  using header_handler = std::function<void(const json&)>;
+
+  namespace details
+  {
+    // read string data from json object
+    inline std::string get_field(const json& obj, const std::string& field_name)
+    {
+      if (!obj.contains(field_name) ||
+          !obj[field_name].is_string() ||
+          obj[field_name].empty())
+        return {};
+      return obj[field_name].get<std::string>();
+    }
+
+    // read the login data and custom fields of a selected item
+    //  items which aren't logins (notes, cards...) have no login data - a login (type 1) must have one
+    inline void read_login(const json& login, const json& fields, struct item& item)
+    {
+      // check login format
+      if ((item.type == 1) ? !login.is_object() : (!login.is_null() && !login.is_object()))
+        throw std::runtime_error("invalid json file format");
+
+      item.username = get_field(login, "username");
+      item.password = get_field(login, "password");
+      item.totp = get_field(login, "totp");
+      item.uri = (login.contains("uris") && login["uris"].size()) ?
+        get_field(login["uris"].at(0), "uri") : "";
+      for (const auto& f : fields)
+        if (!get_field(f, "name").empty())
+          item.fields.push_back({ get_field(f, "name"), get_field(f, "value") });
+    }
+
+    // read an item from its json object and hand it to the handler if selected
+    inline void read_item(const json& obj, const selector& select, const item_handler& on_item)
+    {
+      // check item format
+      if ((!obj.contains("name") || !obj["name"].is_string()) ||
+          (!obj.contains("type") || !obj["type"].is_number()) ||
+          (!obj.contains("favorite") || !obj["favorite"].is_boolean()))
+        throw std::runtime_error("invalid json file format");
+
+      // skip non-selected item
+      struct item item;
+      item.name = get_field(obj, "name");
+      item.type = obj["type"].get<int>();
+      item.favorite = obj["favorite"].get<bool>();
+      item.folder_id = get_field(obj, "folderId");
+      item.organization_id = get_field(obj, "organizationId");
+      if (obj.contains("collectionIds") && obj["collectionIds"].is_array())
+        for (const auto& id : obj["collectionIds"])
+          if (id.is_string())
+            item.collection_ids.push_back(id.get<std::string>());
+      if (!select(item))
+        return;
+
+      read_login(obj.contains("login") ? obj["login"] : json(),
+                 obj.contains("fields") ? obj["fields"] : json(),
+                 item);
+      on_item(std::move(item));
+    }
+  }
+
+  // streaming reader of a bitwarden json export based on the nlohmann SAX interface
+  //  the root object is built as a DOM except for its "items" array:
+  //  each item is built alone, handed to the callback and then dropped
+  //  so that the memory usage doesn't depend on the size of the vault
+  class sax_reader final : public nlohmann::json_sax<json>
+  {
+  public:
+    // constructor/destructor
+    sax_reader(const std::function<void(const json&)>& on_item,
+               const header_handler& on_header = {}) :
+      m_on_item(on_item),
+      m_on_header(on_header)
+    {
+    }
+    ~sax_reader() = default;
+
+    // retrieve the root object (with an empty "items" array)
+    json& root() { return m_root; }
+
+    // SAX interface
+    bool null() override { handle_value(nullptr); return true; }
+    bool boolean(bool val) override { handle_value(val); return true; }
+    bool number_integer(number_integer_t val) override { handle_value(val); return true; }
+    bool number_unsigned(number_unsigned_t val) override { handle_value(val); return true; }
+    bool number_float(number_float_t val, const string_t&) override { handle_value(val); return true; }
+    bool string(string_t& val) override { handle_value(std::move(val)); return true; }
+    bool binary(binary_t& val) override { handle_value(std::move(val)); return true; }
+    bool start_object(std::size_t) override
+    {
+      m_stack.push_back(handle_value(json::object()));
+      return true;
+    }
+    bool key(string_t& val) override
+    {
+      // keep track of the "items" key of the root object
+      m_items_key = (m_stack.size() == 1) && (&m_root == m_stack.back()) && (val == "items");
+      m_element = &(*m_stack.back())[val];
+      return true;
+    }
+    bool end_object() override
+    {
+      end_container();
+      return true;
+    }
+    bool start_array(std::size_t) override
+    {
+      const bool items_key = m_items_key;
+      json* arr = handle_value(json::array());
+      if (items_key && (m_stack.size() == 1))
+      {
+        m_items = arr;
+        if (m_on_header)
+          m_on_header(m_root);
+      }
+      m_stack.push_back(arr);
+      return true;
+    }
+    bool end_array() override
+    {
+      if (m_stack.back() == m_items)
+        m_items = nullptr;
+      end_container();
+      return true;
+    }
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+    {
+      throw std::runtime_error(ex.what());
+    }
+
+  private:
+    // add a value to the current container - items are built in a separate DOM
+    template<typename Value>
+    json* handle_value(Value&& val)
+    {
+      m_items_key = false;
+      if (m_stack.empty())
+      {
+        m_root = json(std::forward<Value>(val));
+        return &m_root;
+      }
+      json* parent = m_stack.back();
+      if (parent == m_items)
+      {
+        m_item = json(std::forward<Value>(val));
+        if (!m_item.is_structured())
+          release_item();
+        return &m_item;
+      }
+      if (parent->is_array())
+      {
+        parent->emplace_back(std::forward<Value>(val));
+        return &parent->back();
+      }
+      *m_element = json(std::forward<Value>(val));
+      return m_element;
+    }
+
+    // close the current container - release the item once completed
+    void end_container()
+    {
+      const json* current = m_stack.back();
+      m_stack.pop_back();
+      if (current == &m_item)
+        release_item();
+    }
+
+    // hand the item to the callback then drop it
+    void release_item()
+    {
+      m_on_item(m_item);
+      m_item = json();
+    }
+
+  private:
+    std::function<void(const json&)> m_on_item;
+    header_handler m_on_header;
+    json m_root;
+    json m_item;
+    json* m_items = nullptr;
+    json* m_element = nullptr;
+    bool m_items_key = false;
+    std::vector<json*> m_stack;
+  };
+
+  // parse a bitwarden json export using the nlohmann SAX parser
+  inline json parse_nlohmann(const std::string_view data,
+                             const selector& select,
+                             const item_handler& on_item,
+                             const header_handler& on_header = {})
+  {
+    // stream items one by one to only keep the selected ones
+    sax_reader reader([&](const json& obj) { details::read_item(obj, select, on_item); }, on_header);
+    if (!json::sax_parse(data.data(), data.data() + data.size(), &reader))
+      throw std::runtime_error("invalid json file format");
+    json& root = reader.root();
+    if (!root.is_object())
+      throw std::runtime_error("invalid json file format");
+    return std::move(root);
+  }
+
+#ifdef BW2QR_WITH_SIMDJSON
+  // parse a bitwarden json export using the simdjson on-demand parser
+  //  only the selected items have their login data converted to a DOM
+  //  the data is used in place when enough bytes are readable after its end
+  inline json parse_simdjson(const std::string_view data,
+                             const std::size_t capacity,
+                             const selector& select,
+                             const item_handler& on_item,
+                             const header_handler& on_header = {})
+  {
+    namespace od = simdjson::ondemand;
+    try
+    {
+      // copy the data in a padded buffer only if it can't be read in place
+      simdjson::padded_string copy;
+      simdjson::padded_string_view view(data.data(), data.size(), capacity);
+      if (capacity < data.size() + simdjson::SIMDJSON_PADDING)
+      {
+        copy = simdjson::padded_string(data);
+        view = copy;
+      }
+
+      // iterate over the root object - keep everything but the items
+      od::parser parser;
+      od::document doc = parser.iterate(view);
+      json root = json::object();
+      for (od::field member : doc.get_object())
+      {
+        const std::string key(member.unescaped_key().value());
+        od::value value = member.value();
+        if (key != "items" || value.type() != od::json_type::array)
+        {
+          root[key] = json::parse(value.raw_json().value());
+          continue;
+        }
+        root[key] = json::array();
+        if (on_header)
+          on_header(root);
+
+        // read the header of every item - convert the login data of the selected ones
+        for (od::value v : value.get_array())
+        {
+          if (v.type() != od::json_type::object)
+            throw std::runtime_error("invalid json file format");
+          struct item item;
+          bool has_name = false;
+          bool has_type = false;
+          bool has_favorite = false;
+          std::string_view login;
+          std::string_view fields;
+          for (od::field f : v.get_object())
+          {
+            const std::string_view k = f.unescaped_key().value();
+            od::value fv = f.value();
+            if (k == "name")
+            {
+              if (fv.type() != od::json_type::string)
+                throw std::runtime_error("invalid json file format");
+              item.name = std::string(fv.get_string().value());
+              has_name = true;
+            }
+            else if (k == "type")
+            {
+              if (fv.type() != od::json_type::number)
+                throw std::runtime_error("invalid json file format");
+              item.type = static_cast<int>(fv.get_double().value());
+              has_type = true;
+            }
+            else if (k == "favorite")
+            {
+              if (fv.type() != od::json_type::boolean)
+                throw std::runtime_error("invalid json file format");
+              item.favorite = fv.get_bool().value();
+              has_favorite = true;
+            }
+            else if ((k == "folderId") || (k == "organizationId"))
+            {
+              std::string& id = (k == "folderId") ? item.folder_id : item.organization_id;
+              if (fv.type() == od::json_type::string)
+                id = std::string(fv.get_string().value());
+            }
+            else if (k == "collectionIds")
+            {
+              if (fv.type() == od::json_type::array)
+                for (od::value id : fv.get_array())
+                  if (id.type() == od::json_type::string)
+                    item.collection_ids.emplace_back(id.get_string().value());
+            }
+            else if (k == "login")
+              login = fv.raw_json().value();
+            else if (k == "fields")
+              fields = fv.raw_json().value();
+          }
+          if (!has_name || !has_type || !has_favorite)
+            throw std::runtime_error("invalid json file format");
+
+          // skip non-selected item
+          if (!select(item))
+            continue;
+          details::read_login(login.empty() ? json() : json::parse(login),
+                              fields.empty() ? json() : json::parse(fields),
+                              item);
+          on_item(std::move(item));
+        }
+      }
+      return root;
+    }
+    catch (const simdjson::simdjson_error& ex)
+    {
+      throw std::runtime_error(fmt::format("invalid json file format: {}", ex.what()));
+    }
+  }
+#endif
+
+  // parse a bitwarden json export and stream the selected items
+  //  the data is read in place: capacity is the number of readable bytes from its start
+  //  returns the root object without the items (an encrypted export may have no items)
+  inline json parse(const std::string_view data,
+                    const std::size_t capacity,
+                    const backend parser,
+                    const selector& select,
+                    const item_handler& on_item,
+                    const header_handler& on_header = {})
+  {
+#ifdef BW2QR_WITH_SIMDJSON
+    if (parser == backend::simdjson)
+      return parse_simdjson(data, capacity, select, on_item, on_header);
+#else
+    static_cast<void>(capacity);
+    static_cast<void>(parser);
+#endif
+    return parse_nlohmann(data, select, on_item, on_header);
+  }
+}
@@ -1,30 +1,43 @@
 #include <map>
+#include <memory>
 #include <cmath>
-#include <regex>
 #include <vector>
 #include <string>
-#include <fstream>
-#include <mutex>
-#include <queue>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
 #include <thread>
+#include <atomic>
+#include <future>
+#include <fstream>
+#include <numeric>
 #include <algorithm>
 #include <filesystem>
 #include <functional>
+#include <optional>
 #include <stdbool.h>
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <fmt/color.h>
 #include <nlohmann/json.hpp>
-#pragma warning( push )
-#pragma warning( disable: 4005 )
-#include <podofo/podofo.h>
-#pragma warning( pop )
 #include <winpp/console.hpp>
 #include <winpp/parser.hpp>
 #include <winpp/utf8.hpp>
-#include <winpp/progress-bar.hpp>
 #include "QrCode.h"
+#include "favicon.hpp"
 #include "openssl-aes.hpp"
+#include "openssl-kdf.hpp"
+#include "bitwarden-reader.hpp"
+#include "bitwarden-crypto.hpp"
+#include "mapped-file.hpp"
+#include "payload.hpp"
+#include "selection.hpp"
+#include "png-cache.hpp"
+#include "pipeline.hpp"
+#include "pdf-writer.hpp"
+#include "schedule.hpp"
+#include "progress.hpp"
+#include "journal.hpp"
 
 using json = nlohmann::ordered_json;
 
@@ -38,6 +51,12 @@ const std::string PROGRAM_VERSION = "3.0.3";
 // default length in characters to align status 
 constexpr std::size_t g_status_len = 50;
 
+// stream of the status messages - standard error when the pdf is written to standard output
+std::FILE* g_status_output = stdout;
+
+// number of entries abandoned by the watchdog - their threads may still be running
+std::atomic<std::size_t> g_abandoned_entries(0);
+
 // qrcode properties
 struct qr_entry {
   std::string title;
@@ -45,18 +64,28 @@ struct qr_entry {
   std::string url;
 };
 
+// QR Code of an entry - or the reason of its failure
+struct qr_result {
+  std::size_t index = 0;
+  struct qr::PngImage png;
+  std::string failure;
+  bool timed_out = false;
+  bool rendered = false;
+  double duration = 0.0;
+};
+
 /*============================================
 | Function definitions
 ==============================================*/
 // lambda function to show colored tags
 auto add_tag = [](const fmt::color color, const std::string& text) {
-  fmt::print(fmt::format(fmt::fg(color) | fmt::emphasis::bold, "[{}]\n", text));
+  fmt::print(g_status_output, fmt::format(fmt::fg(color) | fmt::emphasis::bold, "[{}]\n", text));
 };
 
 // execute a sequence of actions with tags
 void exec(const std::string& str, std::function<void()> fct)
 {
-  fmt::print(fmt::format(fmt::emphasis::bold, "{:<" + std::to_string(g_status_len) + "}", str + ": "));
+  fmt::print(g_status_output, fmt::format(fmt::emphasis::bold, "{:<" + std::to_string(g_status_len) + "}", str + ": "));
   try
   {
     fct();
@@ -69,88 +98,254 @@ void exec(const std::string& str, std::function<void()> fct)
   }
 }
 
-// create QR Code (called by threads)
-void create_qr_code(std::mutex& mutex,
-                    const std::string& password,
-                    const std::string& iv_b64,
-                    std::map<std::string, struct qr::PngImage>& qr_entries_png,
-                    std::queue<struct qr_entry>& qr_entries_data,
-                    const std::initializer_list<details::OptionsVal>& qr_stylesheet,
-                    std::string& qr_failures,
-                    console::progress_bar& progress_bar)
+// convert a bitwarden item into a QR Code entry
+struct qr_entry make_qr_entry(const struct bitwarden::item& item,
+                              const payload::format format,
+                              const bool encrypted,
+                              payload::writer& writer)
+{
+  // binary data is base64 encoded when not encrypted
+  const std::string& data = writer.write(item, format);
+  const std::string& qr_data = !payload::is_binary(format) ? utf8::to_utf8(data) :
+    encrypted ? data : base64::encode(data);
+  return { utf8::to_utf8(item.name), qr_data, item.uri };
+}
+
+// pad the data of an entry to the maximum size of the QR Code
+void pad_qr_entry(struct qr_entry& entry, const aes::cipher* cipher)
+{
+  // check that the size of the QR Code data
+  //  version:  25
+  //  size:     117x117
+  //  ecc:      quartile
+  //  bytes:    715
+  const std::size_t qr_max_size = 715;
+  const std::size_t max_size = !cipher ?
+    qr_max_size :
+    aes::get_max_size(cipher->get_mode(), qr_max_size);
+  if (entry.data.size() > max_size)
+    throw std::runtime_error(fmt::format("entry size too big: {} (should be <= {})", entry.data.size(), max_size));
+
+  // force the length of the json string to maximum size
+  //  in order to always have QR Code of the same class/size - padded in bytes, not in display width
+  if (entry.data.size() < max_size)
+    entry.data.append(max_size - entry.data.size(), ' ');
+}
+
+// create the QR Code of one entry - its data is already padded and encrypted
+const struct qr::PngImage create_qr_code(const struct qr_entry& entry,
+                                        const std::vector<details::OptionsVal>& qr_stylesheet,
+                                        cache::png_cache* png_cache,
+                                        const favicon::prefetcher* favicons,
+                                        const bool logo_speculative,
+                                        bool* cached = nullptr)
+{
+  // take the prefetched logo - empty if not downloaded in time
+  const std::string& logo = favicons ? favicons->get(entry.url) : "";
+
+  // reuse the QR Code image of a previous run if unchanged
+  struct qr::PngImage png;
+  const std::string& key = png_cache ? png_cache->get_key(entry.title, entry.data, entry.url, logo) : "";
+  if (png_cache && png_cache->load(key, png))
+  {
+    if (cached)
+      *cached = true;
+    return png;
+  }
+
+  // set QR Code properties and stylesheet
+  qr::QrCode qrcode({
+    option::qrcode_title(entry.title),
+    option::qrcode_data(entry.data),
+    option::qrcode_url(entry.url),
+    option::qrcode_ecc(qr::ecc::quartile)
+    });
+  for (const auto& opt : qr_stylesheet)
+    qrcode.set({ opt });
+  if (favicons)
+    qrcode.set({ option::qrcode_logo(logo), option::frame_logo_speculative(logo_speculative) });
+
+  // generate the QR Code image
+  png = qrcode.get();
+  if (png_cache)
+    png_cache->store(key, png);
+  return png;
+}
+
+// create the QR Code of one entry within a time budget - returns nothing if it is exceeded
+//  the QR Code is created in a separate thread which can't be interrupted: once the budget is exceeded,
+//  the entry is abandoned and its thread is left running with its own references to the shared data
+std::optional<struct qr::PngImage> create_qr_code_within(const std::chrono::milliseconds timeout,
+                                                         const struct qr_entry& entry,
+                                                         const std::shared_ptr<const std::vector<details::OptionsVal>>& qr_stylesheet,
+                                                         const std::shared_ptr<cache::png_cache>& png_cache,
+                                                         const std::shared_ptr<const favicon::prefetcher>& favicons,
+                                                         const bool logo_speculative,
+                                                         bool& cached)
+{
+  auto hit = std::make_shared<bool>(false);
+  auto task = std::make_shared<std::packaged_task<struct qr::PngImage()>>([=]() {
+    return create_qr_code(entry, *qr_stylesheet, png_cache.get(), favicons.get(), logo_speculative, hit.get());
+    });
+  std::future<struct qr::PngImage> png = task->get_future();
+  std::thread([task]() { (*task)(); }).detach();
+  if (png.wait_for(timeout) == std::future_status::timeout)
+  {
+    ++g_abandoned_entries;
+    return std::nullopt;
+  }
+  struct qr::PngImage result = png.get();
+  cached = *hit;
+  return result;
+}
+
+// run a step of an entry - record its failure
+void run_qr_step(struct qr_result& result, const std::function<void()>& fct)
+{
+  try
+  {
+    fct();
+  }
+  catch (const std::exception& ex)
+  {
+    result.failure = ex.what();
+  }
+  catch (...)
+  {
+    result.failure = "unknown issue";
+  }
+}
+
+// number of entries taken at once by a thread when encrypted - their payloads are encrypted in one batch
+//  larger groups fill more aes lanes but hand more of the most expensive entries to the same thread
+constexpr std::size_t g_encrypt_group_size = 4;
+
+// create QR Codes (called by threads)
+//  each thread takes the next group of items of the dispatch order using an atomic index and converts them into entries
+//  the payloads of the group are encrypted in one batch, then its QR Codes are created in the order of the pdf
+//  each result is pushed to the pdf stage: the window bounds the number of results waiting in memory
+void create_qr_codes(const aes::cipher* qr_cipher,
+                     const payload::format format,
+                     const std::vector<struct bitwarden::item>& items,
+                     const std::vector<std::size_t>& order,
+                     const std::vector<std::size_t>& dispatch,
+                     std::atomic<std::size_t>& next_item,
+                     pipeline::window& window,
+                     pipeline::bounded_queue<struct qr_result>& qr_results,
+                     const std::shared_ptr<const std::vector<details::OptionsVal>> qr_stylesheet,
+                     const std::shared_ptr<cache::png_cache> png_cache,
+                     const std::shared_ptr<const favicon::prefetcher> favicons,
+                     const bool logo_speculative,
+                     const std::chrono::milliseconds entry_timeout,
+                     journal::journal* qr_journal,
+                     progress::reporter& progress)
 {
-  while (true)
+  // each thread encrypts with its own copy of the cipher context
+  std::optional<aes::cipher> cipher;
+  if (qr_cipher)
+    cipher.emplace(qr_cipher->clone());
+  const std::size_t group_size = cipher ? g_encrypt_group_size : 1;
+  payload::writer writer;
+  for (std::size_t first = next_item.fetch_add(group_size); first < items.size(); first = next_item.fetch_add(group_size))
   {
-    // take one element from the queue - protected by mutex
-    struct qr_entry entry;
+    // the window is acquired in the order of the pdf: the lowest entry still in flight never waits
+    std::vector<std::size_t> group(dispatch.begin() + first, dispatch.begin() + std::min(first + group_size, items.size()));
+    std::sort(group.begin(), group.end());
+    std::vector<struct qr_result> results(group.size());
+    std::vector<struct qr_entry> entries(group.size());
+    std::vector<std::string> keys(group.size());
+    std::vector<bool> to_render(group.size(), false);
+
+    // convert the items into padded entries - reuse the QR Codes rendered by the interrupted run
+    std::vector<std::size_t> encrypted;
+    std::vector<std::string> payloads;
+    for (std::size_t g = 0; g < group.size(); ++g)
     {
-      std::lock_guard<std::mutex> lck(mutex);
-      if (qr_entries_data.empty())
-        break;
-      entry = qr_entries_data.front();
-      qr_entries_data.pop();
+      const auto start = std::chrono::steady_clock::now();
+      results[g].index = group[g];
+      run_qr_step(results[g], [&]() {
+        entries[g] = make_qr_entry(items[order[group[g]]], format, cipher.has_value(), writer);
+        if (qr_journal)
+          keys[g] = qr_journal->get_key(entries[g].title, entries[g].data, entries[g].url);
+        if (qr_journal && qr_journal->find(keys[g], results[g].png))
+          return;
+        pad_qr_entry(entries[g], cipher ? &*cipher : nullptr);
+        to_render[g] = true;
+        if (cipher)
+        {
+          encrypted.push_back(g);
+          payloads.push_back(std::move(entries[g].data));
+        }
+        });
+      results[g].duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 
-    // create the QR Code
-    try
+    // encrypt data using aes-256-cbc or aes-256-gcm algorithm - the batch time is shared by its entries
+    //  the gcm nonces are made unique by the positions of the entries in the pdf
+    if (!encrypted.empty())
     {
-      // check that the size of the QR Code data
-      //  version:  25
-      //  size:     117x117
-      //  ecc:      quartile
-      //  bytes:    715
-      const std::size_t qr_max_size = 715;
-      const std::size_t max_size = password.empty() ?
-        qr_max_size :
-        std::floor(std::floor(qr_max_size / 16.0) * 16 * 3 / 4 / 16.0) * 16 - 1;
-      if (entry.data.size() > max_size)
-        throw std::runtime_error(fmt::format("entry size too big: {} (should be <= {})", entry.data.size(), max_size));
-
-      // force the length of the json string to maximum size
-      //  in order to always have QR Code of the same class/size
-      entry.data = fmt::format("{:<" + std::to_string(max_size) + "}", entry.data);
-
-      // encrypt data using aes-256-cbc algorithm
-      if (!password.empty())
-        entry.data = aes::encrypt_256_cbc(entry.data, iv_b64, password);
-
-      // set QR Code properties and stylesheet
-      qr::QrCode qrcode({
-        option::qrcode_title(entry.title),
-        option::qrcode_data(entry.data),
-        option::qrcode_url(entry.url),
-        option::qrcode_ecc(qr::ecc::quartile)
+      const auto start = std::chrono::steady_clock::now();
+      struct qr_result batch;
+      run_qr_step(batch, [&]() {
+        std::vector<std::size_t> indexes;
+        for (const auto& g : encrypted)
+          indexes.push_back(group[g]);
+        std::vector<std::string> ciphers = aes::encrypt_batch(*cipher, payloads, indexes);
+        for (std::size_t e = 0; e < encrypted.size(); ++e)
+          entries[encrypted[e]].data = std::move(ciphers[e]);
         });
-      qrcode.set(qr_stylesheet);
-
-      // generate the QR Code image
-      const struct qr::PngImage& png = qrcode.get();
-
-      // update QR Code images - protected by mutex
+      const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / encrypted.size();
+      for (const auto& g : encrypted)
       {
-        std::lock_guard<std::mutex> lck(mutex);
-        qr_entries_png[entry.title] = png;
+        results[g].duration += duration;
+        results[g].failure = batch.failure;
       }
     }
-    catch(const std::exception& ex)
-    {
-      std::lock_guard<std::mutex> lck(mutex);
-      qr_failures += fmt::format("\nfor entry: \"{}\": {}", entry.title, ex.what());
-    }
-    catch (...)
-    {
-      std::lock_guard<std::mutex> lck(mutex);
-      qr_failures += fmt::format("\nfor entry: \"{}\": unknown issue", entry.title);
-    }
 
-    // update progress-bar - protected by mutex
+    // create the QR Codes - record the new ones in the journal
+    for (std::size_t g = 0; g < group.size(); ++g)
     {
-      std::lock_guard<std::mutex> lck(mutex);
-      progress_bar.tick();
+      if (!window.acquire(group[g]))
+        return;
+      struct qr_result& result = results[g];
+      const auto start = std::chrono::steady_clock::now();
+      if (to_render[g] && result.failure.empty())
+        run_qr_step(result, [&]() {
+          bool cached = false;
+          if (!entry_timeout.count())
+            result.png = create_qr_code(entries[g], *qr_stylesheet, png_cache.get(), favicons.get(), logo_speculative, &cached);
+          else if (auto png = create_qr_code_within(entry_timeout, entries[g], qr_stylesheet, png_cache, favicons, logo_speculative, cached))
+            result.png = std::move(*png);
+          else
+          {
+            result.failure = fmt::format("timed out after {}s", entry_timeout.count() / 1000.0);
+            result.timed_out = true;
+          }
+          result.rendered = result.failure.empty() && !cached;
+          if (qr_journal && result.failure.empty())
+            qr_journal->append(keys[g], result.png);
+          });
+      result.duration += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      progress.tick();
+      if (!qr_results.push(std::move(result)))
+        return;
     }
   }
 }
 
+// exit code of the program - without waiting for the entries abandoned by the watchdog
+//  their threads can't be joined: the program exits without destroying the static objects they use
+int finish(const int code)
+{
+  if (g_abandoned_entries)
+  {
+    std::fflush(stdout);
+    std::fflush(stderr);
+    std::_Exit(code);
+  }
+  return code;
+}
+
 int main(int argc, char** argv)
 {
   // initialize Windows console
@@ -160,6 +355,31 @@ int main(int argc, char** argv)
   std::filesystem::path json_file;
   std::filesystem::path pdf_file;
   std::string password;
+  std::string cipher_name               = "aes-256-cbc";
+  std::string kdf_name                  = "sha256";
+  std::size_t kdf_iterations            = 0;
+  std::size_t kdf_memory                = 0;
+  double kdf_time                       = 0.0;
+  std::string export_password;
+  std::string export_key;
+  std::string json_parser               = "nlohmann";
+  std::string payload_format            = "json";
+  std::string filter_expression         = "type=login;favorite=true";
+  std::filesystem::path cache_dir;
+  std::size_t cache_size                = 64;
+  std::size_t jobs                      = 0;
+  std::size_t magick_threads            = 0;
+  std::string schedule_policy           = "lpt";
+  std::string sort_by                   = "name";
+  bool reproducible                     = false;
+  std::filesystem::path schedule_history;
+  bool keep_going                       = false;
+  std::filesystem::path failure_report;
+  double entry_timeout                  = 0.0;
+  std::filesystem::path journal_file;
+  bool resume                           = false;
+  double favicon_timeout                = 5.0;
+  std::string logo_render               = "sequential";
   std::size_t qrcode_module_px_size     = 3;
   std::size_t qrcode_border_px_size     = 2;
   std::string qrcode_module_color       = "black";
@@ -175,9 +395,32 @@ int main(int argc, char** argv)
   std::size_t pdf_cols                  = 4;
   std::size_t pdf_rows                  = 5;
   console::parser parser(PROGRAM_NAME, PROGRAM_VERSION);
-  parser.add("j", "json",                     "path to the bitwarden json file",                                                                          json_file, true)
-        .add("p", "pdf",                      "path to the pdf output file",                                                                              pdf_file, true)
+  parser.add("j", "json",                     "path to the bitwarden json file (- for standard input)",                                                   json_file, true)
+        .add("p", "pdf",                      "path to the pdf output file (- for standard output)",                                                      pdf_file, true)
         .add("z", "password",                 "set a password to encrypt QR Code data using AES-256-CBC algorithm",                                       password)
+        .add("C", "cipher",                   fmt::format("{:<45}(default: {})", "cipher: aes-256-cbc or aes-256-gcm",        cipher_name),               cipher_name)
+        .add("A", "kdf",                      fmt::format("{:<45}(default: {})", "password kdf: sha256, pbkdf2-sha256, argon2id", kdf_name),         kdf_name)
+        .add("I", "kdf-iterations",           fmt::format("{:<45}(default: {})", "iterations of the password kdf",            "auto"),                    kdf_iterations)
+        .add("Q", "kdf-memory",               fmt::format("{:<45}(default: {})", "memory cost in KiB of the argon2id kdf",    "auto"),                    kdf_memory)
+        .add("L", "kdf-time",                 fmt::format("{:<45}(default: {})", "seconds of kdf calibrated on this machine (0: none)", kdf_time),      kdf_time)
+        .add("u", "export-password",          "password of a password protected bitwarden json file",                                                     export_password)
+        .add("v", "export-key",               "base64 symmetric key of an account restricted bitwarden json file",                                        export_key)
+        .add("i", "json-parser",              fmt::format("{:<45}(default: {})", "json parser: nlohmann or simdjson",         json_parser),               json_parser)
+        .add("d", "payload-format",           fmt::format("{:<45}(default: {})", "QR Code data: json, compact, cbor, msgpack", payload_format),           payload_format)
+        .add("t", "filter",                   fmt::format("{:<45}(default: {})", "selection of the entries: key=value;...",   filter_expression),         filter_expression)
+        .add("b", "cache-dir",                "directory of the cache of the QR Code images, encrypted ones reused for the same IV (disabled if empty)",  cache_dir)
+        .add("g", "cache-size",               fmt::format("{:<45}(default: {})", "maximum size in MiB of the QR Code cache",  cache_size),                cache_size)
+        .add("n", "jobs",                     fmt::format("{:<45}(default: {})", "number of QR Codes generated in parallel",  "auto"),                    jobs)
+        .add("M", "magick-threads",           fmt::format("{:<45}(default: {})", "number of graphicsmagick threads per QR Code", "auto"),                 magick_threads)
+        .add("S", "schedule",                 fmt::format("{:<45}(default: {})", "order of the QR Codes generation: fifo or lpt", schedule_policy),     schedule_policy)
+        .add("K", "keep-going",               "skip the entries which fail instead of stopping",                                                          keep_going)
+        .add("F", "failure-report",           "path to the json report of the failed entries (disabled if empty)",                                        failure_report)
+        .add("E", "entry-timeout",            fmt::format("{:<45}(default: {})", "seconds before abandoning an entry (0: none)", entry_timeout),        entry_timeout)
+        .add("O", "sort-by",                  fmt::format("{:<45}(default: {})", "order of the QR Codes in pdf: vault or name", sort_by),                sort_by)
+        .add("D", "reproducible",             "same pdf bytes for the same inputs: fixed dates and IV derived from the entries",                         reproducible)
+        .add("J", "journal",                  "path to the journal of the QR Codes used to resume a run (disabled if empty)",                             journal_file)
+        .add("U", "resume",                   "resume the interrupted run recorded in the journal",                                                       resume)
+        .add("H", "schedule-history",         "path to the durations of the previous runs used by the schedule (disabled if empty)",                     schedule_history)
         .add("m", "qrcode-module-px-size",    fmt::format("{:<45}(default: {})", "size in pixels of each QR Code module",     qrcode_module_px_size),     qrcode_module_px_size)
         .add("o", "qrcode-border-px-size",    fmt::format("{:<45}(default: {})", "size in pixels of the QR Code border",      qrcode_border_px_size),     qrcode_border_px_size)
         .add("q", "qrcode-module-color",      fmt::format("{:<45}(default: {})", "QR Code module color",                      qrcode_module_color),       qrcode_module_color)
@@ -187,6 +430,8 @@ int main(int argc, char** argv)
         .add("e", "frame-border-height-size", fmt::format("{:<45}(default: {})", "size in pixels of the frame border height", frame_border_height_size),  frame_border_height_size)
         .add("r", "frame-border-radius",      fmt::format("{:<45}(default: {})", "size in pixels of the frame border radius", frame_border_radius),       frame_border_radius)
         .add("l", "frame-logo-size",          fmt::format("{:<45}(default: {})", "size in pixels of the logo",                frame_logo_size),           frame_logo_size)
+        .add("T", "favicon-timeout",          fmt::format("{:<45}(default: {})", "seconds to wait for a logo before skipping it", favicon_timeout),     favicon_timeout)
+        .add("R", "logo-render",              fmt::format("{:<45}(default: {})", "QR Code with logo: sequential or speculative", logo_render),          logo_render)
         .add("f", "frame-font-family",        fmt::format("{:<45}(default: {})", "font family of the QR Code name",           frame_font_family),         frame_font_family)
         .add("c", "frame-font-color",         fmt::format("{:<45}(default: {})", "font color of the QR Code name",            frame_font_color),          frame_font_color)
         .add("s", "frame-font-size",          fmt::format("{:<45}(default: {})", "size in pixels of the QR Code name font",   frame_font_size),           frame_font_size)
@@ -200,142 +445,200 @@ int main(int argc, char** argv)
 
   try
   {
+    // "-" reads the json file from standard input and writes the pdf to standard output
+    const bool json_from_stdin = (json_file == "-");
+    const bool pdf_to_stdout = (pdf_file == "-");
+    if (pdf_to_stdout)
+      g_status_output = stderr;
+
     // check arguments validity
-    if (!std::filesystem::exists(json_file) || json_file.extension().string() != ".json")
+    if (!json_from_stdin && (!std::filesystem::exists(json_file) || json_file.extension().string() != ".json"))
       throw std::runtime_error(fmt::format("invalid bitwarden json file: \"{}\"", json_file.u8string()));
-    if (pdf_file.empty() || pdf_file.extension().string() != ".pdf")
+    if (!pdf_to_stdout && (pdf_file.empty() || pdf_file.extension().string() != ".pdf"))
       throw std::runtime_error(fmt::format("invalid output filename: \"{}\"", pdf_file.u8string()));
-
-    // parse bitwarden json file
-    std::queue<struct qr_entry> qr_entries_data;
+    const bitwarden::backend backend = bitwarden::get_backend(json_parser);
+    const payload::format format = payload::get_format(payload_format);
+    const schedule::policy policy = schedule::get_policy(schedule_policy);
+    if ((logo_render != "sequential") && (logo_render != "speculative"))
+      throw std::runtime_error(fmt::format("invalid logo render: \"{}\"", logo_render));
+    if ((sort_by != "vault") && (sort_by != "name"))
+      throw std::runtime_error(fmt::format("invalid sort key: \"{}\"", sort_by));
+    if (resume && journal_file.empty())
+      throw std::runtime_error("can't resume without a journal file: missing --journal");
+    if ((kdf_time > 0.0) && (kdf_iterations || kdf_memory))
+      throw std::runtime_error("can't calibrate the kdf with explicit costs: --kdf-time excludes --kdf-iterations and --kdf-memory");
+    struct kdf::params kdf_params = kdf::get_params(kdf_name, kdf_iterations, kdf_memory);
+    const aes::mode cipher_mode = aes::get_mode(cipher_name);
+    if (reproducible && !password.empty() && (cipher_mode == aes::mode::gcm))
+      throw std::runtime_error("can't be reproducible with aes-256-gcm: the nonces must never be reused");
+    selection::filter filter(filter_expression);
+
+    // index the folders and collections of the export before reading its items
+    //  an account restricted export needs its key to read their names
+    //  the ones listed after the items are indexed once the export is read
+    std::optional<struct bitwarden::symmetric_key> items_key;
+    auto on_header = [&](const json& header) {
+      if (bitwarden::is_account_restricted(header))
+      {
+        if (export_key.empty())
+          throw std::runtime_error("the bitwarden json file is encrypted: missing --export-key");
+        items_key = bitwarden::get_symmetric_key(export_key);
+        bitwarden::check_key(header, *items_key);
+      }
+      filter.index(header, items_key ? &*items_key : nullptr, false);
+    };
+
+    // parse bitwarden json file - stream items one by one to only keep the selected ones
+    auto is_selected = [&](const struct bitwarden::item& item) -> bool {
+      return filter(item);
+    };
+    json root;
+    std::vector<struct bitwarden::item> items;
     exec("parse bitwarden json file", [&]() {
-      // open json file for read
-      std::ifstream file(json_file);
-      if (!file.good())
-        throw std::runtime_error(fmt::format("can't open file: \"{}\"", json_file.u8string()));
-
-      // lambda to read string data from json object
-      auto get_field = [](const json& obj, const std::string& field_name) -> const std::string {
-        if (!obj.contains(field_name) ||
-            !obj[field_name].is_string() ||
-            obj[field_name].empty())
-          return {};
-        return obj[field_name].get<std::string>();
+      auto on_item = [&](struct bitwarden::item&& item) {
+        items.push_back(std::move(item));
       };
 
-      // parse json file
-      const auto& db = json::parse(file);
-      if (!db.contains("items") || !db["items"].is_array())
-        throw std::runtime_error("invalid json file format");
-      for (const auto& item : db["items"])
+      // read standard input in memory - erase it once parsed
+      if (json_from_stdin)
       {
-        // check item format
-        if ((!item.contains("name") || !item["name"].is_string()) ||
-            (!item.contains("type") || !item["type"].is_number()) ||
-            (!item.contains("favorite") || !item["favorite"].is_boolean()))
-          throw std::runtime_error("invalid json file format");
-
-        // skip non login or non-favorite item
-        if (item["type"].get<int>() != 1 || !item["favorite"].get<bool>())
-          continue;
-
-        // check login format
-        if (!item.contains("login") || !item["login"].is_object())
-          throw std::runtime_error("invalid json file format");
-
-        // create json object based on entry
-        json entry;
-        entry["login"] = json::object();
-        entry["login"]["username"] = get_field(item["login"], "username");
-        entry["login"]["password"] = get_field(item["login"], "password");
-        entry["login"]["totp"] = get_field(item["login"], "totp");
-        entry["fields"] = json::array();
-        if (item.contains("fields"))
+        std::string data = io::read_stdin();
+        try
         {
-          for (const auto& field : item["fields"])
-          {
-            if (!get_field(field, "name").empty())
-            {
-              json obj;
-              obj[get_field(field, "name")] = get_field(field, "value");
-              entry["fields"].push_back(obj);
-            }
-          }
+          root = bitwarden::parse(data, data.size(), backend, is_selected, on_item, on_header);
         }
-
-        // create qrcode entry
-        const std::string& title = get_field(item, "name");
-        const std::string& data = std::regex_replace(entry.dump(2), std::regex(R"([ ]{4}[{]\s[ ]{6}([^\n]+)\n[ ]{4}[}])"), "    { $1 }");
-        const std::string& url = (item["login"].contains("uris") && item["login"]["uris"].size()) ? 
-          get_field(item["login"]["uris"].at(0), "uri") : "";
-
-        // add to queue of qrcodes
-        qr_entries_data.push({ utf8::to_utf8(title), utf8::to_utf8(data), url });
+        catch (...)
+        {
+          OPENSSL_cleanse(data.data(), data.size());
+          throw;
+        }
+        OPENSSL_cleanse(data.data(), data.size());
+        return;
       }
+
+      // map json file in memory - parse it in place
+      const io::mapped_file file(json_file);
+      root = bitwarden::parse(file.view(), file.capacity(), backend, is_selected, on_item, on_header);
       });
-    if (qr_entries_data.empty())
-      throw std::runtime_error("no \"favorite\" entry found");
 
-    // generate a random base64 std::string IV
+    // decrypt password protected json file - the whole vault is a single encrypted string
+    if (bitwarden::is_password_protected(root))
+    {
+      std::string vault;
+      exec("decrypt password protected json file", [&]() {
+        const struct bitwarden::symmetric_key& key = bitwarden::derive_export_key(root, export_password);
+        bitwarden::check_key(root, key);
+        vault = bitwarden::decrypt(root["data"].get<std::string>(), key);
+        });
+      exec("parse decrypted bitwarden json file", [&]() {
+        root = bitwarden::parse(vault, vault.size(), backend, is_selected, [&](struct bitwarden::item&& item) {
+          items.push_back(std::move(item));
+          }, on_header);
+        });
+      OPENSSL_cleanse(vault.data(), vault.size());
+    }
+    if (!root.contains("items") || !root["items"].is_array())
+      throw std::runtime_error("invalid json file format");
+
+    // filter again the items selected before their folders and collections were known - names still encrypted
+    if (!filter.indexed())
+    {
+      filter.index(root, items_key ? &*items_key : nullptr);
+      items.erase(std::remove_if(items.begin(), items.end(), [&](const struct bitwarden::item& item) { return !filter(item); }), items.end());
+    }
+
+    // decrypt account restricted json file - every string of the items is encrypted
+    if (items_key)
+    {
+      exec("decrypt bitwarden items", [&]() {
+        bitwarden::decrypt_items(items, *items_key, std::max(1u, std::thread::hardware_concurrency()));
+        });
+    }
+
+    if (items.empty())
+      throw std::runtime_error(fmt::format("no entry matches the filter: \"{}\"", filter_expression));
+
+    // create QR Code stylesheet of the entries - identifies the QR Codes of the previous runs
+    const std::initializer_list<details::OptionsVal> qr_stylesheet = {
+      option::qrcode_module_px_size(qrcode_module_px_size),
+      option::qrcode_border_px_size(qrcode_border_px_size),
+      option::qrcode_module_color(qrcode_module_color),
+      option::qrcode_background_color(qrcode_background_color),
+      option::frame_border_color(frame_border_color),
+      option::frame_border_width_size(frame_border_width_size),
+      option::frame_border_height_size(frame_border_height_size),
+      option::frame_border_radius(frame_border_radius),
+      option::frame_logo_size(frame_logo_size),
+      option::frame_font_family(frame_font_family),
+      option::frame_font_color(frame_font_color),
+      option::frame_font_size(frame_font_size)
+    };
+
+    // read the journal of the interrupted run - created with the same cipher and kdf algorithm
+    const std::string& qr_fingerprint = PROGRAM_VERSION + '\n' + cache::get_fingerprint(qr_stylesheet);
+    const std::string& journal_fingerprint = qr_fingerprint + "\ncipher:" + cipher_name + "\nkdf:" + kdf_params.algorithm;
+    std::unique_ptr<journal::journal> qr_journal;
+    bool resumed = false;
+    if (!journal_file.empty())
+    {
+      qr_journal = std::make_unique<journal::journal>(journal_file);
+      if (resume)
+        exec("read journal file", [&]() {
+          resumed = qr_journal->load(journal_fingerprint);
+          });
+    }
+
+    // generate a random base64 std::string IV and kdf salt - reuse the ones of the interrupted run
+    //  a reproducible run derives them from the options and the entries
+    //  the gcm nonces use a new IV even when resumed: the entries of the journal keep their own nonces
     std::string iv_b64;
     std::string iv_hex;
     if (!password.empty())
     {
-      exec("generate a random IV", [&]() {
-        const std::vector<unsigned char>& iv = aes::generate_iv();
+      const bool reuse_iv = resumed && (cipher_mode == aes::mode::cbc);
+      std::string iv_seed(qr_fingerprint);
+      if (reproducible && !resumed)
+        for (const auto& item : items)
+          iv_seed += fmt::format("\n{}:{};{}:{};", item.name.size(), item.name, item.uri.size(), item.uri);
+      exec(reuse_iv ? "reuse the IV of the journal" : reproducible ? "derive the IV from the entries" : "generate a random IV", [&]() {
+        const std::vector<unsigned char>& iv = reuse_iv ? base64::decode(qr_journal->iv()) :
+                                               reproducible ? aes::derive_iv(iv_seed) : aes::generate_iv();
         iv_b64 = base64::encode(std::string(iv.begin(), iv.end()));
         for (const auto& byte : iv)
           iv_hex += fmt::format("{:02x}", byte);
         });
+      if (resumed)
+        kdf_params = kdf::from_string(qr_journal->kdf());
+      else if (kdf::is_salted(kdf_params))
+      {
+        kdf_params.salt = reproducible ? kdf::derive_salt(iv_seed) : kdf::generate_salt();
+        if (kdf_time > 0.0)
+          exec("calibrate the key derivation", [&]() {
+            kdf::calibrate(kdf_params, std::chrono::milliseconds(static_cast<long long>(kdf_time * 1000)));
+            });
+      }
     }
 
-    // generate all QR Codes for entries - store png images
-    std::map<std::string, struct qr::PngImage> qr_entries_png;
+    // derive the key from the password and expand it once - the threads encrypt with copies of this context
+    //  the journal derives its password check and its record keys from the same key
+    std::unique_ptr<aes::cipher> qr_cipher;
+    std::vector<unsigned char> key;
+    if (!password.empty())
     {
-      console::progress_bar progress_bar("generate all entries QR Codes:", qr_entries_data.size());
-
-      // create QR Code stylesheet
-      const std::initializer_list<details::OptionsVal> qr_stylesheet = { 
-        option::qrcode_module_px_size(qrcode_module_px_size),
-        option::qrcode_border_px_size(qrcode_border_px_size),
-        option::qrcode_module_color(qrcode_module_color),
-        option::qrcode_background_color(qrcode_background_color),
-        option::frame_border_color(frame_border_color),
-        option::frame_border_width_size(frame_border_width_size),
-        option::frame_border_height_size(frame_border_height_size),
-        option::frame_border_radius(frame_border_radius),
-        option::frame_logo_size(frame_logo_size),
-        option::frame_font_family(frame_font_family),
-        option::frame_font_color(frame_font_color),
-        option::frame_font_size(frame_font_size)
-      };
-
-      // start threads
-      std::mutex mutex;
-      std::string qr_failures;
-      const std::size_t max_cpu = static_cast<std::size_t>(std::thread::hardware_concurrency());
-      const std::size_t nb_threads = std::min(qr_entries_data.size(), max_cpu);
-      std::vector<std::thread> threads(nb_threads);
-      for (auto& t : threads)
-        t = std::thread(create_qr_code,
-                        std::ref(mutex),
-                        std::ref(password),
-                        std::ref(iv_b64),
-                        std::ref(qr_entries_png),
-                        std::ref(qr_entries_data),
-                        std::ref(qr_stylesheet),
-                        std::ref(qr_failures),
-                        std::ref(progress_bar));
-
-      // wait for threads completion
-      for (auto& t : threads)
-        if (t.joinable())
-          t.join();
-
-      // check if QR Code convertion has failed
-      if (!qr_failures.empty())
-        throw std::runtime_error(qr_failures);
+      exec(fmt::format("derive the key using {}", kdf_params.algorithm), [&]() {
+        key = kdf::derive(password, kdf_params, 32);
+        qr_cipher = std::make_unique<aes::cipher>(iv_b64, key, cipher_mode);
+        });
     }
+    if (qr_journal)
+    {
+      if (password.empty())
+        fmt::print(g_status_output, "{} the journal stores the entries unencrypted: \"{}\"\n",
+          fmt::format(fmt::fg(fmt::color::orange) | fmt::emphasis::bold, "warning:"),
+          journal_file.u8string());
+      qr_journal->open(journal_fingerprint, iv_b64, kdf::to_string(kdf_params), key);
+    }
+    OPENSSL_cleanse(key.data(), key.size());
 
     // generate all footers QR Codes - store png images
     std::vector<struct qr::PngImage> qr_footers_png;
@@ -372,124 +675,232 @@ int main(int argc, char** argv)
         };
 
         // add the IV and URL QR Codes to the footers - try to get the same QR Code size by playing with qrcode_border_px_size
-        qr_footers_png.push_back(create_footer_qrcode("iv b64",   iv_b64,                                     4, "#7F0000"));
-        qr_footers_png.push_back(create_footer_qrcode("decrypt",  "https://cryptii.com/pipes/aes-encryption", 2, "#00137F"));
-        qr_footers_png.push_back(create_footer_qrcode("iv hex",   iv_hex,                                     2, "#7F0000"));
+        //  the gcm QR Codes carry their own nonce: only the URL is needed
+        if (cipher_mode == aes::mode::gcm)
+          qr_footers_png.push_back(create_footer_qrcode("decrypt", "https://gchq.github.io/CyberChef",         2, "#00137F"));
+        else
+        {
+          qr_footers_png.push_back(create_footer_qrcode("iv b64",  iv_b64,                                     4, "#7F0000"));
+          qr_footers_png.push_back(create_footer_qrcode("decrypt", "https://cryptii.com/pipes/aes-encryption", 2, "#00137F"));
+          qr_footers_png.push_back(create_footer_qrcode("iv hex",  iv_hex,                                     2, "#7F0000"));
+        }
+
+        // add the settings of the key derivation - the salt and the cost needed to derive the key again
+        if (kdf::is_salted(kdf_params))
+          qr_footers_png.push_back(create_footer_qrcode("kdf",     kdf::to_string(kdf_params),                 0, "#7F0000"));
         });
     }
 
-    // write all QR Codes to pdf file - resolution: 150dpi
-    exec("write all QR Codes to PDF file", [&]() {
-      // skip invalid parameters
-      if (qr_entries_png.empty())
-        throw std::runtime_error("no entry QR Codes to generate");
-      if (!pdf_cols || !pdf_rows)
-        throw std::runtime_error(fmt::format("invalid number of rows: {} or columns: {}", pdf_rows, pdf_cols));
-
-      // create the pdf document and disable debugging informations
-      PoDoFo::PdfError::EnableDebug(false);
-      PoDoFo::PdfMemDocument pdf;
-
-      // create the A4 pdf pages
-      const std::size_t qr_per_pages = pdf_cols * pdf_rows;
-      const std::size_t nb_pages = std::ceil(static_cast<double>(qr_entries_png.size()) / qr_per_pages);
-      std::size_t page_width = 0;
-      std::size_t page_height = 0;
-      for (int i = 0; i < nb_pages; ++i)
+    // generate all QR Codes for entries - place them in the pdf as soon as they are ready
+    //  parsed items -> worker threads (serialize, encrypt, render, verify) -> bounded queue -> pdf pages
+    std::unique_ptr<pdf::writer> pdf_writer;
+    bool has_failures = false;
+    {
+      // open the cache of the QR Code images - keyed by the program version and the stylesheet
+      //  the cache, the favicons and the stylesheet are shared with the entries abandoned by the watchdog
+      //  encrypted with a random IV, the QR Codes never match a cached image: the cache is skipped
+      const auto qr_entry_stylesheet = std::make_shared<const std::vector<details::OptionsVal>>(qr_stylesheet);
+      //  a reproducible IV and salt are derived from all the names and urls: any added, renamed or removed entry
+      //  changes them and every encrypted QR Code misses the cache
+      const bool random_iv = !password.empty() && ((cipher_mode == aes::mode::gcm) || (!reproducible && !resumed));
+      std::shared_ptr<cache::png_cache> png_cache;
+      if (!cache_dir.empty() && random_iv)
+        fmt::print(g_status_output, "{} the QR Codes cache is disabled: the IV is random (use --reproducible or --resume)\n",
+          fmt::format(fmt::fg(fmt::color::orange) | fmt::emphasis::bold, "warning:"));
+      else if (!cache_dir.empty())
       {
-        PoDoFo::PdfPage* page = pdf.CreatePage(PoDoFo::PdfPage::CreateStandardPageSize(PoDoFo::ePdfPageSize_A4));
-        if (!page)
-          throw std::runtime_error("can't create pdf page");
-        page_width = page->GetPageSize().GetWidth();
-        page_height = page->GetPageSize().GetHeight();
+        if (!password.empty() && !resumed)
+          fmt::print(g_status_output, "{} the encrypted QR Codes are only found in the cache if no entry was added, renamed or removed\n",
+            fmt::format(fmt::fg(fmt::color::orange) | fmt::emphasis::bold, "warning:"));
+        if (password.empty())
+          fmt::print(g_status_output, "{} the QR Codes cache stores the entries unencrypted: \"{}\"\n",
+            fmt::format(fmt::fg(fmt::color::orange) | fmt::emphasis::bold, "warning:"),
+            cache_dir.u8string());
+        png_cache = std::make_shared<cache::png_cache>(cache_dir,
+                                                       cache_size * 1024 * 1024,
+                                                       qr_fingerprint);
       }
-      if (!page_width || !page_height)
-        throw std::runtime_error(fmt::format("invalid pdf page width: {} or height: {}", page_width, page_height));
-
-      // get the size of entry and footer QR Codes images
-      const double scale = 72.0 / 300.0 * 1.30;
-      const std::size_t qr_entry_width = qr_entries_png.begin()->second.width * scale;
-      const std::size_t qr_entry_height = qr_entries_png.begin()->second.height * scale;
-      const std::size_t qr_footer_width = qr_footers_png.empty() ? 0 : qr_footers_png.begin()->width * scale;
-      const std::size_t qr_footer_height = qr_footers_png.empty() ? 0 : qr_footers_png.begin()->height * scale;
-
-      // check that everything fits in the pdf page
-      if ((qr_entry_width * pdf_cols) > page_width)
-        throw std::runtime_error(fmt::format("can't place '{}' QR Codes of {}px width within: {}px of A4 page", pdf_cols, qr_entry_width, page_width));
-      if ((qr_entry_height * pdf_rows + qr_footer_height) > page_height)
-        throw std::runtime_error(fmt::format("can't place '{}' QR Codes of {}px height + {}px height within: {}px of A4 page", pdf_rows, qr_entry_height, qr_footer_height, page_height));
-
-      // calc margin size
-      const std::size_t margin_entry_width = (page_width - (pdf_cols * qr_entry_width)) / (pdf_cols + 1);
-      const std::size_t margin_entry_height = (page_height - (pdf_rows * qr_entry_height + qr_footer_height)) / (pdf_rows + 1 + (qr_footers_png.empty() ? 0 : 1));
-      const std::size_t margin_footer_width = (page_width - (qr_footers_png.size() * qr_footer_width)) / (qr_footers_png.size() + 1);
-
-      // lambda to draw png images in pdf
-      auto draw_png = [](PoDoFo::PdfMemDocument& pdf,
-                         PoDoFo::PdfPage* page,
-                         const struct qr::PngImage& png,
-                         const std::size_t px,
-                         const std::size_t py,
-                         const double scale) -> void {
-        PoDoFo::PdfPainter painter;
-        painter.SetPage(page);
-        PoDoFo::PdfImage img(&pdf);
-        img.LoadFromPngData(reinterpret_cast<const unsigned char*>(png.data.c_str()), png.data.size());
-        painter.DrawImage(px, py, &img, scale, scale);
-        painter.FinishPage();
-      };
 
-      // add all QR Codes png images to A4 pdf pages
-      std::size_t qr_idx = 0;
-      for (const auto& [k, v] : qr_entries_png)
+      // open the pdf document - the pages are written while the QR Codes are generated
+      pdf_writer = std::make_unique<pdf::writer>(pdf_file, pdf_cols, pdf_rows, qr_footers_png, reproducible);
+
+      // the progress bar is only drawn on a terminal - redrawn at a fixed rate while the threads are running
+      progress::reporter progress("generate all entries QR Codes", g_status_len, items.size(), g_status_output);
+
+      // place the QR Codes in the pdf in the order of the vault or sorted by their title
+      //  entries with the same title keep the order of the vault
+      std::vector<std::size_t> qr_entries_order(items.size());
+      std::iota(qr_entries_order.begin(), qr_entries_order.end(), 0);
+      if (sort_by == "name")
       {
-        // select the proper pdf page
-        const std::size_t current_page = qr_idx / qr_per_pages;
-        PoDoFo::PdfPage* page = pdf.GetPage(current_page);
-        if (!page)
-          throw std::runtime_error(fmt::format("can't access pdf page: {}", current_page));
-        const std::size_t idx_x = (qr_idx % qr_per_pages) % pdf_cols;
-        const std::size_t idx_y = (qr_idx % qr_per_pages) / pdf_cols;
-        const double px = ((idx_x + 1) * margin_entry_width) + (idx_x * qr_entry_width);
-        const double py = page_height - ((idx_y + 1) * (margin_entry_height + qr_entry_height));
-        draw_png(pdf, page, v, px, py, scale);
-        ++qr_idx;
+        std::vector<std::string> titles(items.size());
+        for (std::size_t i = 0; i < items.size(); ++i)
+          titles[i] = utf8::to_utf8(items[i].name);
+        std::stable_sort(qr_entries_order.begin(), qr_entries_order.end(), [&](const std::size_t a, const std::size_t b) {
+          return titles[a] < titles[b];
+          });
       }
 
-      // draw footers QR Codes on the bottom of the pdf
-      for (int i = 0; i < nb_pages; ++i)
+      // download the logos in background in the order of the QR Codes - while they are generated
+      std::shared_ptr<const favicon::prefetcher> favicons;
+      if (frame_logo_size)
+      {
+        std::vector<std::string> urls;
+        for (const auto& i : qr_entries_order)
+          urls.push_back(items[i].uri);
+        favicons = std::make_shared<const favicon::prefetcher>(urls, frame_logo_size, std::chrono::milliseconds(static_cast<long long>(favicon_timeout * 1000)));
+      }
+
+      // start threads - the window bounds the number of QR Codes in memory
+      const struct schedule::thread_budget budget = schedule::get_thread_budget(items.size(), jobs, magick_threads, (logo_render == "speculative") && (frame_logo_size != 0));
+      const std::size_t nb_threads = budget.jobs;
+      const std::size_t window_size = nb_threads * 4;
+      qr::set_magick_threads(budget.magick_threads);
+
+      // hand the most expensive QR Codes first to the threads - so that none is left running alone at the end
+      schedule::cost_model cost_model(schedule_history, frame_logo_size != 0, !password.empty());
+      const std::vector<std::size_t>& qr_entries_dispatch = schedule::get_dispatch_order(cost_model.get_costs(items, qr_entries_order), window_size, policy);
+      std::vector<double> durations(items.size(), 0.0);
+      const auto start = std::chrono::steady_clock::now();
+      std::atomic<std::size_t> next_item(0);
+      pipeline::window window(window_size);
+      pipeline::bounded_queue<struct qr_result> qr_results(window_size);
+      std::vector<std::thread> threads(nb_threads);
+      for (auto& t : threads)
+        t = std::thread(create_qr_codes,
+                        qr_cipher.get(),
+                        format,
+                        std::ref(items),
+                        std::ref(qr_entries_order),
+                        std::ref(qr_entries_dispatch),
+                        std::ref(next_item),
+                        std::ref(window),
+                        std::ref(qr_results),
+                        qr_entry_stylesheet,
+                        png_cache,
+                        favicons,
+                        logo_render == "speculative",
+                        std::chrono::milliseconds(static_cast<long long>(entry_timeout * 1000)),
+                        qr_journal.get(),
+                        std::ref(progress));
+
+      // add the QR Codes to the pdf in order - keep the results which are ready too early
+      //  the first failure stops the generation unless keep-going is set: failed entries are then skipped
+      std::string qr_failures;
+      json failures = json::array();
+      try
       {
-        // select the proper pdf page
-        PoDoFo::PdfPage* page = pdf.GetPage(i);
-        if (!page)
-          throw std::runtime_error(fmt::format("can't access pdf page: {}", i));
-        std::size_t f_idx = 0;
-        for (const auto& f : qr_footers_png)
+        std::map<std::size_t, struct qr_result> pending;
+        std::size_t next_placed = 0;
+        bool stopped = false;
+        struct qr_result result;
+        for (std::size_t n = 0; !stopped && (n < items.size()) && qr_results.pop(result); ++n)
         {
-          const double px = ((f_idx + 1) * margin_footer_width) + (f_idx * qr_footer_width);
-          const double py = page_height - ((pdf_rows * (qr_entry_height + margin_entry_height)) + qr_footer_height + margin_entry_height);
-          draw_png(pdf, page, f, px, py, scale);
-          ++f_idx;
+          // the QR Codes reused from the journal or the cache don't measure the cost of their entry
+          if (result.failure.empty())
+          {
+            durations[result.index] = result.duration;
+            if (result.rendered)
+              cost_model.update(items[qr_entries_order[result.index]], result.duration);
+          }
+          pending.emplace(result.index, std::move(result));
+          for (auto it = pending.find(next_placed); !stopped && (it != pending.end()); it = pending.find(next_placed))
+          {
+            // check if QR Code convertion has failed - stop the threads
+            if (!it->second.failure.empty())
+            {
+              const struct bitwarden::item& item = items[qr_entries_order[it->first]];
+              qr_failures += fmt::format("\nfor entry: \"{}\": {}", utf8::to_utf8(item.name), it->second.failure);
+              failures.push_back({
+                {"name", utf8::to_utf8(item.name)},
+                {"url", item.uri},
+                {"error", it->second.failure},
+                {"timeout", it->second.timed_out}
+                });
+              if (!keep_going)
+              {
+                window.cancel();
+                qr_results.close();
+                stopped = true;
+              }
+            }
+            else
+              pdf_writer->add(it->second.png);
+            pending.erase(it);
+            window.release();
+            ++next_placed;
+          }
         }
       }
+      catch (...)
+      {
+        window.cancel();
+        qr_results.close();
+        for (auto& t : threads)
+          if (t.joinable())
+            t.join();
+        throw;
+      }
 
-      // write pdf to disk
-      if (std::filesystem::exists(pdf_file))
+      // wait for threads completion
+      for (auto& t : threads)
+        if (t.joinable())
+          t.join();
+      progress.stop();
+
+      // write the machine-readable report of the failed entries
+      if (!failure_report.empty())
       {
-        std::ofstream file(pdf_file);
-        if (!file.is_open())
-          throw std::runtime_error(fmt::format("can't write to file: \"{}\" - already open?", pdf_file.u8string()));
+        exec(fmt::format("write failure report ({} failed entries)", failures.size()), [&]() {
+          const json report = {
+            {"entries", items.size()},
+            {"failures", failures}
+          };
+          std::ofstream file(failure_report, std::ios::binary);
+          if (!(file << report.dump(2)))
+            throw std::runtime_error(fmt::format("can't write failure report: \"{}\"", failure_report.u8string()));
+          });
+      }
+      has_failures = !qr_failures.empty();
+      if (has_failures)
+      {
+        if (!keep_going)
+          throw std::runtime_error(qr_failures);
+        fmt::print(g_status_output, "{} {} entries skipped:{}\n",
+          fmt::format(fmt::fg(fmt::color::orange) | fmt::emphasis::bold, "warning:"),
+          failures.size(),
+          qr_failures);
       }
-      pdf.Write(pdf_file.string().c_str());
+
+      // compare the makespan to the ideal one - update the durations history
+      const double makespan = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      exec(fmt::format("schedule QR Codes ({:.2f}s, ideal: {:.2f}s)", makespan, schedule::get_ideal_makespan(durations, nb_threads)), [&]() {
+        cost_model.save();
+        });
+
+      // evict the least recently used QR Code images
+      if (png_cache)
+        exec(fmt::format("update QR Codes cache ({} hits, {} misses)", png_cache->hits(), png_cache->misses()), [&]() {
+          png_cache->evict();
+          });
+    }
+
+    // finish writing the pdf file
+    exec("write all QR Codes to PDF file", [&]() {
+      pdf_writer->close();
       });
 
-    return 0;
+    // the journal is no longer needed once every QR Code is in the pdf
+    if (qr_journal && !has_failures)
+      qr_journal->remove();
+
+    return finish(0);
   }
   catch (const std::exception& ex)
   {
-    fmt::print("{} {}\n",
+    fmt::print(g_status_output, "{} {}\n",
       fmt::format(fmt::fg(fmt::color::red) | fmt::emphasis::bold, "error:"),
       ex.what());
-    return -1;
+    return finish(-1);
   }
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#if defined(_M_X64) || defined(__x86_64__)
+#define BW2QR_WITH_X64_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BW2QR_TARGET(features)
+#else
+#include <cpuid.h>
+#define BW2QR_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+namespace cpu
+{
+  // instruction sets used by the vectorized code paths
+  struct features
+  {
+    bool ssse3 = false;
+    bool aesni = false;
+    bool avx2 = false;
+  };
+
+#ifdef BW2QR_WITH_X64_SIMD
+  namespace details
+  {
+    // read the registers eax, ebx, ecx, edx of a cpuid leaf
+    inline bool cpuid(const unsigned int leaf, unsigned int regs[4])
+    {
+#ifdef _MSC_VER
+      int r[4] = { 0 };
+      __cpuid(r, 0);
+      if (static_cast<unsigned int>(r[0]) < leaf)
+        return false;
+      __cpuidex(r, static_cast<int>(leaf), 0);
+      for (int i = 0; i < 4; ++i)
+        regs[i] = static_cast<unsigned int>(r[i]);
+      return true;
+#else
+      if (__get_cpuid_max(0, nullptr) < leaf)
+        return false;
+      __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+      return true;
+#endif
+    }
+
+    // check that the os saves the avx registers on context switches
+    inline bool has_os_avx()
+    {
+#ifdef _MSC_VER
+      return (_xgetbv(0) & 0x6) == 0x6;
+#else
+      unsigned int eax = 0, edx = 0;
+      __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      return (eax & 0x6) == 0x6;
+#endif
+    }
+
+    // detect the instruction sets of the processor
+    inline struct features detect()
+    {
+      struct features f;
+      unsigned int regs[4] = { 0 };
+      if (!cpuid(1, regs))
+        return f;
+      f.ssse3 = (regs[2] & (1u << 9)) != 0;
+      f.aesni = (regs[2] & (1u << 25)) != 0;
+      const bool avx = ((regs[2] & (1u << 27)) != 0) && ((regs[2] & (1u << 28)) != 0) && has_os_avx();
+      if (avx && cpuid(7, regs))
+        f.avx2 = (regs[1] & (1u << 5)) != 0;
+      return f;
+    }
+  }
+
+  // instruction sets of the processor - detected once
+  inline const struct features& get_features()
+  {
+    static const struct features f = details::detect();
+    return f;
+  }
+#else
+  // no vectorized code path on this architecture
+  inline const struct features& get_features()
+  {
+    static const struct features f;
+    return f;
+  }
+#endif
+}
@@ -3,7 +3,15 @@
 #include <regex>
 #include <chrono>
 #include <map>
+#include <vector>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
 #include <stdbool.h>
+#include <fmt/core.h>
+#include <fmt/format.h>
 #include <httplib.h>
 
 namespace favicon
@@ -163,4 +171,93 @@ namespace favicon
       return false;
     }
   }
+
+  // download the favicons of the urls in background I/O threads
+  //  each url is downloaded once, in the given order, so that the first needed icons are ready first
+  //  consumers wait for an icon until its deadline and go without it afterwards
+  //  the deadline of an icon is set when it is queued: one timeout per round of downloads before its turn
+  class prefetcher final
+  {
+    // delete copy/assignement operators
+    prefetcher(const prefetcher&) = delete;
+    prefetcher& operator=(const prefetcher&) = delete;
+    prefetcher(prefetcher&&) = delete;
+    prefetcher& operator=(prefetcher&&) = delete;
+
+  public:
+    // constructor/destructor
+    prefetcher(const std::vector<std::string>& urls,
+               const std::size_t logo_size,
+               const std::chrono::milliseconds& timeout,
+               const std::size_t nb_threads = 16) :
+      m_logo_size(logo_size)
+    {
+      // keep the unique urls in order
+      const auto start = std::chrono::steady_clock::now();
+      const std::size_t nb_workers = std::max<std::size_t>(1, nb_threads);
+      for (const auto& url : urls)
+      {
+        if (url.empty() || m_icons.count(url))
+          continue;
+        const std::size_t round = m_urls.size() / nb_workers;
+        m_urls.push_back(url);
+        m_promises.emplace_back();
+        m_icons[url] = { m_promises.back().get_future().share(), start + timeout * (round + 1) };
+      }
+
+      // start the I/O threads
+      m_threads.resize(std::min(nb_workers, m_urls.size()));
+      for (auto& t : m_threads)
+        t = std::thread(&prefetcher::download_worker, this);
+    }
+    ~prefetcher()
+    {
+      // skip the remaining downloads - wait for the current ones (bounded by their timeouts)
+      m_stop = true;
+      for (auto& t : m_threads)
+        if (t.joinable())
+          t.join();
+    }
+
+    // retrieve the icon of an url - empty if not available before its deadline
+    std::string get(const std::string& url) const
+    {
+      const auto it = m_icons.find(url);
+      if ((it == m_icons.end()) || (it->second.icon.wait_until(it->second.deadline) != std::future_status::ready))
+        return {};
+      return it->second.icon.get();
+    }
+
+  private:
+    // download the icons of the urls (called by threads)
+    void download_worker()
+    {
+      for (std::size_t i = m_next++; (i < m_urls.size()) && !m_stop; i = m_next++)
+      {
+        // download the icon - using google-api or favicon otherwise
+        std::string icon_content;
+        if (!download_with_google_api(m_urls[i], m_logo_size, icon_content))
+          if (!download_with_generic_api(m_urls[i], m_logo_size, icon_content))
+            icon_content.clear();
+        m_promises[i].set_value(icon_content);
+      }
+    }
+
+  private:
+    // icon of an url and the time until which it is waited for
+    struct pending_icon
+    {
+      std::shared_future<std::string> icon;
+      std::chrono::steady_clock::time_point deadline;
+    };
+
+  private:
+    const std::size_t m_logo_size;
+    std::vector<std::string> m_urls;
+    std::vector<std::promise<std::string>> m_promises;
+    std::unordered_map<std::string, struct pending_icon> m_icons;
+    std::atomic<std::size_t> m_next{ 0 };
+    std::atomic<bool> m_stop{ false };
+    std::vector<std::thread> m_threads;
+  };
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <stdexcept>
+#include <filesystem>
+#include <system_error>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <openssl/sha.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+#include "QrCode.h"
+#include "openssl-kdf.hpp"
+
+namespace journal
+{
+  namespace details
+  {
+    // magic string at the start of the journal file
+    const std::string magic("bw2qr-journal-3\n");
+
+    // convert bytes in hexadecimal
+    inline std::string to_hex(const unsigned char* data, const std::size_t size)
+    {
+      std::string hex;
+      for (std::size_t i = 0; i < size; ++i)
+        hex += fmt::format("{:02x}", data[i]);
+      return hex;
+    }
+
+    // write a 32 bits little-endian value
+    inline void write_u32(std::string& buf, const std::size_t value)
+    {
+      for (int i = 0; i < 4; ++i)
+        buf += static_cast<char>((value >> (i * 8)) & 0xff);
+    }
+
+    // write a length-prefixed string
+    inline void write_str(std::string& buf, const std::string& str)
+    {
+      write_u32(buf, str.size());
+      buf += str;
+    }
+
+    // read a 32 bits little-endian value - returns false at the end of the file
+    inline bool read_u32(std::istream& is, std::size_t& value)
+    {
+      unsigned char bytes[4];
+      if (!is.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+        return false;
+      value = 0;
+      for (int i = 0; i < 4; ++i)
+        value |= static_cast<std::size_t>(bytes[i]) << (i * 8);
+      return true;
+    }
+
+    // read a length-prefixed string - returns false at the end of the file
+    inline bool read_str(std::istream& is, std::string& str)
+    {
+      std::size_t size = 0;
+      if (!read_u32(is, size) || (size > 64 * 1024 * 1024))
+        return false;
+      str.resize(size);
+      return size ? static_cast<bool>(is.read(&str[0], size)) : true;
+    }
+  }
+
+  // append-only journal of the QR Codes images of a run
+  //  each QR Code is appended and flushed as soon as it is rendered so that an interrupted run
+  //  can be resumed: its IV is reused and only the missing QR Codes are rendered again
+  //  the journal is only reused with the same options (fingerprint) and the same password
+  //  the settings of the key derivation are reused too: the salt and the cost of the interrupted run
+  //  the records and the password check are keyed by the cipher key: nothing in the journal can be
+  //  used to test a guessed entry or password without going through the key derivation
+  //  without password the key is fixed and the images hold the entries in clear text: usernames,
+  //  passwords and totp secrets - the journal must then be protected like the vault export
+  class journal final
+  {
+    // delete copy/assignement operators
+    journal(const journal&) = delete;
+    journal& operator=(const journal&) = delete;
+    journal(journal&&) = delete;
+    journal& operator=(journal&&) = delete;
+
+  public:
+    // constructor/destructor
+    explicit journal(const std::filesystem::path& path) :
+      m_path(path)
+    {
+    }
+    ~journal()
+    {
+      OPENSSL_cleanse(m_mac_key.data(), m_mac_key.size());
+    }
+
+    // read the journal of an interrupted run - returns false if there is none
+    //  the incomplete record written when the run was interrupted is dropped
+    //  the password is checked once the key is derived: when the journal is opened
+    bool load(const std::string& fingerprint)
+    {
+      std::ifstream file(m_path, std::ios::binary);
+      if (!file)
+        return false;
+      std::string magic(details::magic.size(), '\0');
+      std::string file_fingerprint;
+      if (!file.read(&magic[0], magic.size()) || (magic != details::magic) ||
+          !details::read_str(file, file_fingerprint) ||
+          !details::read_str(file, m_iv_b64) ||
+          !details::read_str(file, m_kdf) ||
+          !details::read_str(file, m_check))
+        throw std::runtime_error(fmt::format("invalid journal file: \"{}\"", m_path.u8string()));
+      if (file_fingerprint != fingerprint)
+        throw std::runtime_error(fmt::format("journal file: \"{}\" was created with different options", m_path.u8string()));
+      m_size = static_cast<std::uintmax_t>(file.tellg());
+
+      // read the complete records
+      while (true)
+      {
+        std::string key;
+        struct qr::PngImage png;
+        if (!details::read_str(file, key) ||
+            !details::read_u32(file, png.width) ||
+            !details::read_u32(file, png.height) ||
+            !details::read_str(file, png.data))
+          break;
+        m_pngs[key] = std::move(png);
+        m_size = static_cast<std::uintmax_t>(file.tellg());
+      }
+      m_loaded = true;
+      return true;
+    }
+
+    // start writing the journal - append to the loaded one or create a new one
+    //  the keys of the journal are derived from the cipher key (empty without password)
+    void open(const std::string& fingerprint,
+              const std::string& iv_b64,
+              const std::string& kdf,
+              const std::vector<unsigned char>& cipher_key)
+    {
+      // without password the QR Codes aren't encrypted: a fixed key is used
+      const std::vector<unsigned char>& prk = cipher_key.empty() ? std::vector<unsigned char>(SHA256_DIGEST_LENGTH, 0) : cipher_key;
+      const std::vector<unsigned char>& check_key = kdf::hkdf_expand_sha256(prk, "bw2qr-journal-check", SHA256_DIGEST_LENGTH);
+      const std::string& check = details::to_hex(check_key.data(), check_key.size());
+      m_mac_key = kdf::hkdf_expand_sha256(prk, "bw2qr-journal-key", SHA256_DIGEST_LENGTH);
+      if (m_loaded)
+      {
+        if (check != m_check)
+          throw std::runtime_error(fmt::format("journal file: \"{}\" was created with a different password", m_path.u8string()));
+        std::error_code ec;
+        std::filesystem::resize_file(m_path, m_size, ec);
+        m_file.open(m_path, std::ios::binary | std::ios::app);
+      }
+      else
+      {
+        m_iv_b64 = iv_b64;
+        m_kdf = kdf;
+        std::string buf(details::magic);
+        details::write_str(buf, fingerprint);
+        details::write_str(buf, m_iv_b64);
+        details::write_str(buf, m_kdf);
+        details::write_str(buf, check);
+        m_file.open(m_path, std::ios::binary | std::ios::trunc);
+        m_file.write(buf.data(), buf.size());
+        m_file.flush();
+      }
+      if (!m_file)
+        throw std::runtime_error(fmt::format("can't write journal file: \"{}\"", m_path.u8string()));
+    }
+
+    // compute the key of an entry in the journal - HMAC-SHA256 of its data before encryption
+    std::string get_key(const std::string& title,
+                        const std::string& data,
+                        const std::string& url) const
+    {
+      const std::string& str = fmt::format("{}:{};{}:{};{}:{};", title.size(), title, data.size(), data, url.size(), url);
+      unsigned char digest[EVP_MAX_MD_SIZE];
+      unsigned int len = 0;
+      if (!HMAC(EVP_sha256(), m_mac_key.data(), static_cast<int>(m_mac_key.size()),
+                reinterpret_cast<const unsigned char*>(str.data()), str.size(), digest, &len))
+        throw std::runtime_error("can't compute the journal key of the entry");
+      return details::to_hex(digest, len);
+    }
+
+    // find a QR Code image rendered by the interrupted run
+    bool find(const std::string& key, struct qr::PngImage& png) const
+    {
+      const auto it = m_pngs.find(key);
+      if (it == m_pngs.end())
+        return false;
+      png = it->second;
+      return true;
+    }
+
+    // append a QR Code image to the journal - safe to call from any thread
+    void append(const std::string& key, const struct qr::PngImage& png)
+    {
+      std::string buf;
+      details::write_str(buf, key);
+      details::write_u32(buf, png.width);
+      details::write_u32(buf, png.height);
+      details::write_str(buf, png.data);
+      std::lock_guard<std::mutex> lck(m_mutex);
+      m_file.write(buf.data(), buf.size());
+      m_file.flush();
+    }
+
+    // remove the journal once the pdf is complete
+    void remove()
+    {
+      m_file.close();
+      std::error_code ec;
+      std::filesystem::remove(m_path, ec);
+    }
+
+    // properties of the journal
+    const std::string& iv() const { return m_iv_b64; }
+    const std::string& kdf() const { return m_kdf; }
+    std::size_t size() const { return m_pngs.size(); }
+
+  private:
+    std::filesystem::path m_path;
+    std::string m_iv_b64;
+    std::string m_kdf;
+    std::string m_check;
+    std::vector<unsigned char> m_mac_key;
+    bool m_loaded = false;
+    std::uintmax_t m_size = 0;
+    std::map<std::string, struct qr::PngImage> m_pngs;
+    std::ofstream m_file;
+    std::mutex m_mutex;
+  };
+}
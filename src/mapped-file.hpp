@@ -0,0 +1,162 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <stdexcept>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace io
+{
+  // switch a standard stream to binary mode - no newline translation on windows
+  inline void set_binary_mode(std::FILE* stream)
+  {
+#ifdef _WIN32
+    _setmode(_fileno(stream), _O_BINARY);
+#else
+    (void)stream;
+#endif
+  }
+
+  // read the whole standard input in memory
+  inline std::string read_stdin()
+  {
+    set_binary_mode(stdin);
+    std::string data;
+    std::size_t size = 0;
+    while (true)
+    {
+      data.resize(size + 1024 * 1024);
+      const std::size_t len = std::fread(&data[size], 1, data.size() - size, stdin);
+      size += len;
+      if (len == 0)
+        break;
+    }
+    if (std::ferror(stdin))
+      throw std::runtime_error("can't read from standard input");
+    data.resize(size);
+    return data;
+  }
+
+  // read-only memory-mapped file
+  //  gives a contiguous view of the file content without copying it
+  class mapped_file final
+  {
+    // delete copy/assignement operators
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&&) = delete;
+    mapped_file& operator=(mapped_file&&) = delete;
+
+  public:
+    // constructor/destructor
+    explicit mapped_file(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+      m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      LARGE_INTEGER size;
+      if ((m_file == INVALID_HANDLE_VALUE) || !GetFileSizeEx(m_file, &size))
+      {
+        close();
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.u8string()));
+      }
+      m_size = static_cast<std::size_t>(size.QuadPart);
+      if (m_size)
+      {
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        m_data = m_mapping ? static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+      }
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      m_page_size = info.dwPageSize;
+#else
+      m_file = ::open(path.c_str(), O_RDONLY);
+      struct stat st;
+      if ((m_file < 0) || (::fstat(m_file, &st) != 0))
+      {
+        close();
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.u8string()));
+      }
+      m_size = static_cast<std::size_t>(st.st_size);
+      if (m_size)
+      {
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        m_data = (data != MAP_FAILED) ? static_cast<const char*>(data) : nullptr;
+        if (m_data)
+          ::madvise(data, m_size, MADV_SEQUENTIAL);
+      }
+      m_page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+      if (m_size && !m_data)
+      {
+        close();
+        throw std::runtime_error(fmt::format("can't map file in memory: \"{}\"", path.u8string()));
+      }
+    }
+    ~mapped_file()
+    {
+      close();
+    }
+
+    // access the file content
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::string_view view() const { return { m_data, m_size }; }
+
+    // number of readable bytes - the mapping is rounded up to the page size
+    std::size_t capacity() const
+    {
+      if (!m_size || !m_page_size)
+        return m_size;
+      return ((m_size + m_page_size - 1) / m_page_size) * m_page_size;
+    }
+
+  private:
+    // unmap and close the file
+    void close()
+    {
+#ifdef _WIN32
+      if (m_data)
+        UnmapViewOfFile(m_data);
+      if (m_mapping)
+        CloseHandle(m_mapping);
+      if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+      m_mapping = nullptr;
+      m_file = INVALID_HANDLE_VALUE;
+#else
+      if (m_data)
+        ::munmap(const_cast<char*>(m_data), m_size);
+      if (m_file >= 0)
+        ::close(m_file);
+      m_file = -1;
+#endif
+      m_data = nullptr;
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    std::size_t m_page_size = 0;
+  };
+}
@@ -1,14 +1,111 @@
 #pragma once
 #include <cstring>
+#include <string>
 #include <vector>
+#include <stdexcept>
 #include <utility>
+#include <algorithm>
 #include <openssl/evp.h>
 #include <openssl/aes.h>
 #include <openssl/rand.h>
+#include <openssl/crypto.h>
 #include "openssl-base64.hpp"
+#include "cpu-features.hpp"
+#ifdef BW2QR_WITH_X64_SIMD
+#define BW2QR_WITH_AESNI
+#endif
 
 namespace aes
 {
+#ifdef BW2QR_WITH_AESNI
+  namespace details
+  {
+    // expanded aes-256 key schedule: 15 round keys
+    struct key_schedule
+    {
+      bool valid = false;
+      __m128i keys[15];
+    };
+
+    // compute the next round keys of the aes-256 key schedule
+    BW2QR_TARGET("aes,sse2") inline __m128i expand_key_even(__m128i key, __m128i assist)
+    {
+      assist = _mm_shuffle_epi32(assist, 0xff);
+      key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+      key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+      key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+      return _mm_xor_si128(key, assist);
+    }
+    BW2QR_TARGET("aes,sse2") inline __m128i expand_key_odd(__m128i key, __m128i assist)
+    {
+      assist = _mm_shuffle_epi32(assist, 0xaa);
+      key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+      key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+      key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+      return _mm_xor_si128(key, assist);
+    }
+
+    // expand the aes-256 key
+    BW2QR_TARGET("aes,sse2") inline void expand_key(const unsigned char* key, struct key_schedule& schedule)
+    {
+      __m128i* k = schedule.keys;
+      k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+      k[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+      k[2] = expand_key_even(k[0], _mm_aeskeygenassist_si128(k[1], 0x01));
+      k[3] = expand_key_odd(k[1], _mm_aeskeygenassist_si128(k[2], 0x00));
+      k[4] = expand_key_even(k[2], _mm_aeskeygenassist_si128(k[3], 0x02));
+      k[5] = expand_key_odd(k[3], _mm_aeskeygenassist_si128(k[4], 0x00));
+      k[6] = expand_key_even(k[4], _mm_aeskeygenassist_si128(k[5], 0x04));
+      k[7] = expand_key_odd(k[5], _mm_aeskeygenassist_si128(k[6], 0x00));
+      k[8] = expand_key_even(k[6], _mm_aeskeygenassist_si128(k[7], 0x08));
+      k[9] = expand_key_odd(k[7], _mm_aeskeygenassist_si128(k[8], 0x00));
+      k[10] = expand_key_even(k[8], _mm_aeskeygenassist_si128(k[9], 0x10));
+      k[11] = expand_key_odd(k[9], _mm_aeskeygenassist_si128(k[10], 0x00));
+      k[12] = expand_key_even(k[10], _mm_aeskeygenassist_si128(k[11], 0x20));
+      k[13] = expand_key_odd(k[11], _mm_aeskeygenassist_si128(k[12], 0x00));
+      k[14] = expand_key_even(k[12], _mm_aeskeygenassist_si128(k[13], 0x40));
+      schedule.valid = true;
+    }
+
+    // maximum number of cbc streams encrypted together - enough to hide the latency of aesenc
+    constexpr std::size_t max_lanes = 8;
+
+    // encrypt in place several independent cbc streams with the same key and IV
+    //  the lanes are sorted by decreasing number of blocks: the active ones are always the first ones
+    //  each round is applied to all the lanes before the next one so that the aes units stay busy
+    BW2QR_TARGET("aes,sse2") inline void encrypt_cbc_lanes(const struct key_schedule& schedule,
+                                                     const unsigned char* iv,
+                                                     unsigned char* const* bufs,
+                                                     const std::size_t* nb_blocks,
+                                                     const std::size_t nb_lanes)
+    {
+      const __m128i* k = schedule.keys;
+      __m128i state[max_lanes];
+      for (std::size_t l = 0; l < nb_lanes; ++l)
+        state[l] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+      std::size_t nb_active = nb_lanes;
+      for (std::size_t b = 0; nb_active; ++b)
+      {
+        while (nb_active && (nb_blocks[nb_active - 1] <= b))
+          --nb_active;
+        for (std::size_t l = 0; l < nb_active; ++l)
+        {
+          const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bufs[l] + b * 16));
+          state[l] = _mm_xor_si128(_mm_xor_si128(block, state[l]), k[0]);
+        }
+        for (int r = 1; r < 14; ++r)
+          for (std::size_t l = 0; l < nb_active; ++l)
+            state[l] = _mm_aesenc_si128(state[l], k[r]);
+        for (std::size_t l = 0; l < nb_active; ++l)
+        {
+          state[l] = _mm_aesenclast_si128(state[l], k[14]);
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(bufs[l] + b * 16), state[l]);
+        }
+      }
+    }
+  }
+#endif
+
   // hash std::string using SHA-256 algorithm
   inline const std::vector<unsigned char> hash_sha256(const std::string& data)
   {
@@ -39,37 +136,166 @@ namespace aes
     return iv;
   }
 
-  // encrypt data using:
-  //  cipher algorithm:         AES-256-CBC
-  //  key hash algorithm:       SHA-256
-  //  data padding:             NONE
-  inline const std::string encrypt_256_cbc(const std::string& data, 
-                                           const std::string& iv_b64,
-                                           const std::string& password)
+  // derive a deterministic IV from a seed - the same seed always gives the same IV
+  inline const std::vector<unsigned char> derive_iv(const std::string& seed)
+  {
+    std::vector<unsigned char> iv = hash_sha256("bw2qr-iv:" + seed);
+    iv.resize(AES_BLOCK_SIZE);
+    return iv;
+  }
+
+  // block cipher modes of the QR Codes
+  enum class mode
+  {
+    cbc, // AES-256-CBC: PKCS#7 padding, the same IV for all the entries
+    gcm  // AES-256-GCM: no padding, nonce of the entry + cipher + authentication tag
+  };
+
+  // sizes of the aes-256-gcm nonce: seed of the run + index of the entry (big-endian)
+  constexpr std::size_t gcm_seed_size = 8;
+  constexpr std::size_t gcm_nonce_size = 12;
+  constexpr std::size_t gcm_tag_size = 16;
+
+  // convert the name of a cipher mode
+  inline mode get_mode(const std::string& name)
+  {
+    if (name == "aes-256-cbc")
+      return mode::cbc;
+    if (name == "aes-256-gcm")
+      return mode::gcm;
+    throw std::runtime_error("invalid cipher: \"" + name + "\"");
+  }
+
+  // maximum size of the data whose base64 cipher fits in a number of characters
+  //  cbc: the data and its PKCS#7 padding (at least 1 byte) are rounded to blocks of 16 bytes
+  //  gcm: the nonce and the tag are added to the data
+  inline std::size_t get_max_size(const mode m, const std::size_t max_b64_size)
+  {
+    const std::size_t max_cipher_size = max_b64_size / 4 * 3;
+    if (m == mode::cbc)
+      return max_cipher_size / AES_BLOCK_SIZE * AES_BLOCK_SIZE - 1;
+    return max_cipher_size - gcm_nonce_size - gcm_tag_size;
+  }
+
+  // aes-256 cipher built once from the password and the IV
+  //  cipher algorithm:         AES-256-CBC or AES-256-GCM
+  //  key hash algorithm:       SHA-256 (or the key derived by kdf::derive)
+  //  data padding:             PKCS#7 (cbc) or none (gcm)
+  //  the key is derived and its schedule expanded only once: each thread encrypts with its own clone
+  //  of the context, so that encrypting an entry only costs an IV reset and the update/final calls
+  //  gcm never reuses a nonce with the same key: it is made of the first 8 bytes of the IV of the run
+  //  and of the index of the entry, and is written in front of the cipher so that each QR Code is self-contained
+  class cipher final
   {
-    // initialize context
-    EVP_CIPHER_CTX* ctx = nullptr;
-    try
+    friend std::vector<std::string> encrypt_batch(cipher& c,
+                                                  const std::vector<std::string>& data,
+                                                  const std::vector<std::size_t>& indexes);
+
+    // delete copy/assignement operators
+    cipher(const cipher&) = delete;
+    cipher& operator=(const cipher&) = delete;
+    cipher& operator=(cipher&&) = delete;
+
+  public:
+    // constructor/destructor
+    //  the key is either derived from the password by the caller or its SHA-256 hash
+    cipher(const std::string& iv_b64,
+           const std::string& password) :
+      cipher(iv_b64, hash_sha256(password))
+    {
+    }
+    cipher(const std::string& iv_b64,
+           const std::vector<unsigned char>& key_buf,
+           const mode m = mode::cbc) :
+      m_ctx(EVP_CIPHER_CTX_new()),
+      m_mode(m)
     {
-      // create and initialize the context
-      ctx = EVP_CIPHER_CTX_new();
-      if (!ctx)
+      if (!m_ctx)
         throw std::runtime_error("can't initialize the openssl cipher context");
 
-      // configure cipher context for aes-256-cbc
-      const std::vector<unsigned char>& key_buf = hash_sha256(password);
+      // configure cipher context for aes-256-cbc or aes-256-gcm (96 bits nonce)
       const std::vector<unsigned char>& iv_buf = base64::decode(iv_b64);
       if ((key_buf.size() != AES_BLOCK_SIZE * 2) ||
           (iv_buf.size() != AES_BLOCK_SIZE))
+      {
+        EVP_CIPHER_CTX_free(m_ctx);
         throw std::runtime_error("invalid key or iv size");
-      if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key_buf.data(), iv_buf.data()) != 1)
+      }
+      std::memcpy(m_iv, iv_buf.data(), AES_BLOCK_SIZE);
+      if (m_mode == mode::gcm)
+      {
+        if ((EVP_EncryptInit_ex(m_ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) != 1) ||
+            (EVP_CIPHER_CTX_ctrl(m_ctx, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(gcm_nonce_size), nullptr) != 1) ||
+            (EVP_EncryptInit_ex(m_ctx, nullptr, nullptr, key_buf.data(), nullptr) != 1))
+        {
+          EVP_CIPHER_CTX_free(m_ctx);
+          throw std::runtime_error("can't configure cipher context for aes-256-gcm with key");
+        }
+        return;
+      }
+      if (EVP_EncryptInit_ex(m_ctx, EVP_aes_256_cbc(), nullptr, key_buf.data(), m_iv) != 1)
+      {
+        EVP_CIPHER_CTX_free(m_ctx);
         throw std::runtime_error("can't configure cipher context for aes-256-cbc with key");
+      }
+#ifdef BW2QR_WITH_AESNI
+      // expand the key for the batch encryption
+      if (cpu::get_features().aesni)
+        details::expand_key(key_buf.data(), m_schedule);
+#endif
+    }
+    cipher(cipher&& other) noexcept :
+      m_ctx(std::exchange(other.m_ctx, nullptr)),
+      m_mode(other.m_mode),
+      m_buf(std::move(other.m_buf))
+    {
+      std::memcpy(m_iv, other.m_iv, AES_BLOCK_SIZE);
+#ifdef BW2QR_WITH_AESNI
+      m_schedule = other.m_schedule;
+#endif
+    }
+    ~cipher()
+    {
+      if (m_ctx)
+        EVP_CIPHER_CTX_free(m_ctx);
+#ifdef BW2QR_WITH_AESNI
+      OPENSSL_cleanse(&m_schedule, sizeof(m_schedule));
+#endif
+    }
+
+    // copy the context with its expanded key - one per thread
+    cipher clone() const
+    {
+      EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+      if (!ctx || (EVP_CIPHER_CTX_copy(ctx, m_ctx) != 1))
+      {
+        if (ctx)
+          EVP_CIPHER_CTX_free(ctx);
+        throw std::runtime_error("can't copy the openssl cipher context");
+      }
+      cipher c(ctx, m_iv, m_mode);
+#ifdef BW2QR_WITH_AESNI
+      c.m_schedule = m_schedule;
+#endif
+      return c;
+    }
+
+    // encrypt data - returns the base64 cipher
+    //  the index of the entry is only used by the gcm nonce: it must be unique for the IV of the run
+    const std::string encrypt(const std::string& data, const std::size_t index = 0)
+    {
+      if (m_mode == mode::gcm)
+        return encrypt_gcm(data, index);
+
+      // reset the IV - the key schedule is kept
+      if (EVP_EncryptInit_ex(m_ctx, nullptr, nullptr, nullptr, m_iv) != 1)
+        throw std::runtime_error("can't reset cipher context for aes-256-cbc");
 
-      // encrypt all blocs of 16 bytes of data
-      std::string cipher(data.size() + AES_BLOCK_SIZE, 0);
+      // encrypt all blocs of 16 bytes of data - into the buffer kept between the entries
+      m_buf.resize(data.size() + AES_BLOCK_SIZE);
       int len = 0;
-      if (EVP_EncryptUpdate(ctx,
-                            reinterpret_cast<unsigned char*>(cipher.data()),
+      if (EVP_EncryptUpdate(m_ctx,
+                            m_buf.data(),
                             &len,
                             reinterpret_cast<const unsigned char*>(data.c_str()),
                             data.size()) != 1)
@@ -77,25 +303,131 @@ namespace aes
       int cipher_len = len;
 
       // encrypt the last bloc and finalize encryption
-      if (EVP_EncryptFinal_ex(ctx,
-                              reinterpret_cast<unsigned char*>(cipher.data()) + len,
+      if (EVP_EncryptFinal_ex(m_ctx,
+                              m_buf.data() + len,
                               &len) != 1)
         throw std::runtime_error("can't finalize encryption process");
       cipher_len += len;
-      cipher.resize(cipher_len);
 
-      // free cipher context
-      EVP_CIPHER_CTX_free(ctx);
+      // convert to base64
+      std::string b64(base64::encoded_size(cipher_len), '\0');
+      base64::encode(m_buf.data(), cipher_len, b64.data());
+      return b64;
+    }
 
-      // conver to base64
-      return base64::encode(cipher);
+    // properties of the cipher
+    mode get_mode() const { return m_mode; }
+
+  private:
+    // take ownership of a copied context
+    cipher(EVP_CIPHER_CTX* ctx, const unsigned char* iv, const mode m) :
+      m_ctx(ctx),
+      m_mode(m)
+    {
+      std::memcpy(m_iv, iv, AES_BLOCK_SIZE);
     }
-    catch (const std::exception& ex)
+
+    // encrypt data using aes-256-gcm - returns the base64 of nonce + cipher + tag
+    const std::string encrypt_gcm(const std::string& data, const std::size_t index)
     {
-      // free cipher context
-      if (ctx)
-        EVP_CIPHER_CTX_free(ctx);
-      throw ex;
+      if (index > 0xffffffff)
+        throw std::runtime_error("invalid entry index for the aes-256-gcm nonce");
+      m_buf.resize(gcm_nonce_size + data.size() + gcm_tag_size);
+      unsigned char* nonce = m_buf.data();
+      std::memcpy(nonce, m_iv, gcm_seed_size);
+      for (std::size_t i = 0; i < 4; ++i)
+        nonce[gcm_seed_size + i] = static_cast<unsigned char>((index >> ((3 - i) * 8)) & 0xff);
+
+      // set the nonce - the key schedule and the hash key are kept
+      if (EVP_EncryptInit_ex(m_ctx, nullptr, nullptr, nullptr, nonce) != 1)
+        throw std::runtime_error("can't reset cipher context for aes-256-gcm");
+
+      // encrypt data - no padding: the cipher has the size of the data
+      int len = 0;
+      if (EVP_EncryptUpdate(m_ctx,
+                            nonce + gcm_nonce_size,
+                            &len,
+                            reinterpret_cast<const unsigned char*>(data.c_str()),
+                            static_cast<int>(data.size())) != 1)
+        throw std::runtime_error("can't encrypt data using aes-256-gcm algorithm");
+      if ((EVP_EncryptFinal_ex(m_ctx, nonce + gcm_nonce_size + len, &len) != 1) ||
+          (EVP_CIPHER_CTX_ctrl(m_ctx, EVP_CTRL_GCM_GET_TAG, static_cast<int>(gcm_tag_size), nonce + gcm_nonce_size + data.size()) != 1))
+        throw std::runtime_error("can't finalize encryption process");
+
+      // convert to base64
+      std::string b64(base64::encoded_size(m_buf.size()), '\0');
+      base64::encode(m_buf.data(), m_buf.size(), b64.data());
+      return b64;
     }
+
+  private:
+    EVP_CIPHER_CTX* m_ctx = nullptr;
+    mode m_mode = mode::cbc;
+    std::vector<unsigned char> m_buf;
+    unsigned char m_iv[AES_BLOCK_SIZE] = {};
+#ifdef BW2QR_WITH_AESNI
+    struct details::key_schedule m_schedule;
+#endif
+  };
+
+  // encrypt a batch of independent entries - returns their base64 ciphers
+  //  cbc is sequential within an entry but the entries are independent: with AES-NI, the blocks of
+  //  up to 8 entries are interleaved to keep the aes pipeline full - otherwise they are encrypted one by one
+  //  gcm is already parallel within an entry: its entries are encrypted one by one with their index
+  inline std::vector<std::string> encrypt_batch(cipher& c,
+                                                const std::vector<std::string>& data,
+                                                const std::vector<std::size_t>& indexes)
+  {
+    std::vector<std::string> ciphers;
+    ciphers.reserve(data.size());
+#ifdef BW2QR_WITH_AESNI
+    if (c.m_schedule.valid)
+    {
+      // add the PKCS#7 padding: always between 1 and 16 bytes
+      std::vector<std::string> bufs(data.size());
+      std::vector<std::size_t> nb_blocks(data.size());
+      std::vector<std::size_t> lanes(data.size());
+      for (std::size_t i = 0; i < data.size(); ++i)
+      {
+        const std::size_t pad = AES_BLOCK_SIZE - (data[i].size() % AES_BLOCK_SIZE);
+        bufs[i] = data[i] + std::string(pad, static_cast<char>(pad));
+        nb_blocks[i] = bufs[i].size() / AES_BLOCK_SIZE;
+        lanes[i] = i;
+      }
+
+      // encrypt the entries by groups of lanes - sorted by decreasing size
+      std::stable_sort(lanes.begin(), lanes.end(), [&](const std::size_t a, const std::size_t b) {
+        return nb_blocks[a] > nb_blocks[b];
+        });
+      for (std::size_t first = 0; first < lanes.size(); first += details::max_lanes)
+      {
+        const std::size_t nb_lanes = std::min(details::max_lanes, lanes.size() - first);
+        unsigned char* lane_bufs[details::max_lanes];
+        std::size_t lane_blocks[details::max_lanes];
+        for (std::size_t l = 0; l < nb_lanes; ++l)
+        {
+          lane_bufs[l] = reinterpret_cast<unsigned char*>(bufs[lanes[first + l]].data());
+          lane_blocks[l] = nb_blocks[lanes[first + l]];
+        }
+        details::encrypt_cbc_lanes(c.m_schedule, c.m_iv, lane_bufs, lane_blocks, nb_lanes);
+      }
+
+      // convert to base64
+      for (const auto& buf : bufs)
+        ciphers.push_back(base64::encode(buf));
+      return ciphers;
+    }
+#endif
+    for (std::size_t i = 0; i < data.size(); ++i)
+      ciphers.push_back(c.encrypt(data[i], indexes[i]));
+    return ciphers;
+  }
+
+  // encrypt data using aes-256-cbc - the key is derived for this call only
+  inline const std::string encrypt_256_cbc(const std::string& data, 
+                                           const std::string& iv_b64,
+                                           const std::string& password)
+  {
+    return cipher(iv_b64, password).encrypt(data);
   }
 }
@@ -1,56 +1,287 @@
 #pragma once
+#include <array>
+#include <algorithm>
 #include <string>
-#include <openssl/buffer.h>
-#include <openssl/bio.h>
-#include <openssl/evp.h>
+#include <vector>
+#include <cstddef>
+#include "cpu-features.hpp"
 
 namespace base64
 {
-  // encode in base64 a std::string using openssl
+  namespace details
+  {
+    // alphabet of the standard base64 encoding
+    constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // value of each character in the alphabet - 0xff if invalid
+    inline const std::array<unsigned char, 256>& get_values()
+    {
+      static const std::array<unsigned char, 256> values = []() {
+        std::array<unsigned char, 256> v;
+        v.fill(0xff);
+        for (unsigned char i = 0; i < 64; ++i)
+          v[static_cast<unsigned char>(alphabet[i])] = i;
+        return v;
+      }();
+      return values;
+    }
+
+    // encode the bytes which are left by the vectorized code - adds the padding
+    inline void encode_scalar(const unsigned char* src, const std::size_t size, char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 3 <= size; i += 3, dst += 4)
+      {
+        const unsigned int v = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+        dst[0] = alphabet[(v >> 18) & 0x3f];
+        dst[1] = alphabet[(v >> 12) & 0x3f];
+        dst[2] = alphabet[(v >> 6) & 0x3f];
+        dst[3] = alphabet[v & 0x3f];
+      }
+      if (i < size)
+      {
+        const unsigned int v = (src[i] << 16) | ((i + 1 < size) ? (src[i + 1] << 8) : 0);
+        dst[0] = alphabet[(v >> 18) & 0x3f];
+        dst[1] = alphabet[(v >> 12) & 0x3f];
+        dst[2] = (i + 1 < size) ? alphabet[(v >> 6) & 0x3f] : '=';
+        dst[3] = '=';
+      }
+    }
+
+    // decode the characters which are left by the vectorized code - without padding
+    //  returns the number of bytes written or -1 if a character is invalid
+    inline std::ptrdiff_t decode_scalar(const char* src, const std::size_t size, unsigned char* dst)
+    {
+      const auto& values = get_values();
+      if (size % 4 == 1)
+        return -1;
+      std::size_t o = 0;
+      for (std::size_t i = 0; i < size; i += 4)
+      {
+        const std::size_t n = std::min<std::size_t>(4, size - i);
+        unsigned int v = 0;
+        for (std::size_t c = 0; c < 4; ++c)
+        {
+          const unsigned char value = (c < n) ? values[static_cast<unsigned char>(src[i + c])] : 0;
+          if (value == 0xff)
+            return -1;
+          v = (v << 6) | value;
+        }
+        dst[o++] = static_cast<unsigned char>(v >> 16);
+        if (n > 2)
+          dst[o++] = static_cast<unsigned char>(v >> 8);
+        if (n > 3)
+          dst[o++] = static_cast<unsigned char>(v);
+      }
+      return static_cast<std::ptrdiff_t>(o);
+    }
+
+#ifdef BW2QR_WITH_X64_SIMD
+    // split 12 bytes into 16 indices of 6 bits then convert them into the characters of the alphabet
+    //  the characters are computed by adding an offset selected from the range of the index
+    BW2QR_TARGET("ssse3") inline __m128i encode_block(__m128i in)
+    {
+      in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+      const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+      const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+      const __m128i indices = _mm_or_si128(t0, t1);
+      __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+      range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+      const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+      return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+    }
+
+    // same as encode_block on both lanes: 2 x 12 bytes
+    BW2QR_TARGET("avx2") inline __m256i encode_block(__m256i in)
+    {
+      in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                   10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+      const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+      const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+      const __m256i indices = _mm256_or_si256(t0, t1);
+      __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+      range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+      const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                               'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+      return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+    }
+
+    // encode by blocks of 12 bytes - 16 bytes are read: returns the number of bytes encoded
+    BW2QR_TARGET("ssse3") inline std::size_t encode_ssse3(const unsigned char* src, const std::size_t size, char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 16 <= size; i += 12, dst += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), encode_block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+      return i;
+    }
+
+    // encode by blocks of 24 bytes - 28 bytes are read: returns the number of bytes encoded
+    BW2QR_TARGET("avx2") inline std::size_t encode_avx2(const unsigned char* src, const std::size_t size, char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 28 <= size; i += 24, dst += 32)
+      {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+        const __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), encode_block(in));
+      }
+      return i;
+    }
+
+    // convert 16 characters into their 6 bits values then pack them into 12 bytes
+    //  the characters are validated by a lookup of their low and high nibbles - returns false if invalid
+    BW2QR_TARGET("ssse3") inline bool decode_block(__m128i& str)
+    {
+      const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+      const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+      const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m128i mask_2f = _mm_set1_epi8(0x2f);
+      const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+      const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+      const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+      const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+      if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0)
+        return false;
+      const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(str, mask_2f), hi_nibbles));
+      str = _mm_add_epi8(str, roll);
+      str = _mm_madd_epi16(_mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+      str = _mm_shuffle_epi8(str, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+      return true;
+    }
+
+    // same as decode_block on both lanes: 32 characters into 24 contiguous bytes
+    BW2QR_TARGET("avx2") inline bool decode_block(__m256i& str)
+    {
+      const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                              0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                              0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                              0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+      const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                              0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+      const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+      const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+      const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+      const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+      const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+      if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256())) != 0)
+        return false;
+      const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(str, mask_2f), hi_nibbles));
+      str = _mm256_add_epi8(str, roll);
+      str = _mm256_madd_epi16(_mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+      str = _mm256_shuffle_epi8(str, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+      str = _mm256_permutevar8x32_epi32(str, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+      return true;
+    }
+
+    // decode by blocks of 16 characters - 16 bytes are written: returns the number of characters decoded
+    //  stops before an invalid block or when less than 8 characters would be left for the 4 extra bytes
+    BW2QR_TARGET("ssse3") inline std::size_t decode_ssse3(const char* src, const std::size_t size, unsigned char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 24 <= size; i += 16, dst += 12)
+      {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (!decode_block(str))
+          break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), str);
+      }
+      return i;
+    }
+
+    // decode by blocks of 32 characters - 32 bytes are written: returns the number of characters decoded
+    //  stops before an invalid block or when less than 16 characters would be left for the 8 extra bytes
+    BW2QR_TARGET("avx2") inline std::size_t decode_avx2(const char* src, const std::size_t size, unsigned char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 48 <= size; i += 32, dst += 24)
+      {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (!decode_block(str))
+          break;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), str);
+      }
+      return i;
+    }
+#endif
+  }
+
+  // size of the base64 encoding of a number of bytes - with padding
+  constexpr std::size_t encoded_size(const std::size_t size)
+  {
+    return (size + 2) / 3 * 4;
+  }
+
+  // maximum size of the data decoded from a number of base64 characters
+  constexpr std::size_t decoded_size(const std::size_t size)
+  {
+    return (size + 3) / 4 * 3;
+  }
+
+  // encode in base64 into a buffer of encoded_size(size) characters - returns the number of characters written
+  //  the bulk is encoded by blocks of 24 bytes with AVX2 or 12 bytes with SSSE3, the tail by the scalar code
+  inline std::size_t encode(const unsigned char* src, const std::size_t size, char* dst)
+  {
+    std::size_t i = 0;
+#ifdef BW2QR_WITH_X64_SIMD
+    const struct cpu::features& features = cpu::get_features();
+    if (features.avx2)
+      i = details::encode_avx2(src, size, dst);
+    else if (features.ssse3)
+      i = details::encode_ssse3(src, size, dst);
+#endif
+    details::encode_scalar(src + i, size - i, dst + i / 3 * 4);
+    return encoded_size(size);
+  }
+
+  // decode base64 into a buffer of decoded_size(size) bytes - returns false if the data isn't valid base64
+  //  the padding is optional, no other character than the alphabet is accepted (no line breaks)
+  inline bool decode(const char* src, std::size_t size, unsigned char* dst, std::size_t& dst_size)
+  {
+    dst_size = 0;
+    if ((size % 4 == 0) && (size > 0) && (src[size - 1] == '='))
+      size -= (src[size - 2] == '=') ? 2 : 1;
+    std::size_t i = 0;
+#ifdef BW2QR_WITH_X64_SIMD
+    const struct cpu::features& features = cpu::get_features();
+    if (features.avx2)
+      i = details::decode_avx2(src, size, dst);
+    if (features.ssse3)
+      i += details::decode_ssse3(src + i, size - i, dst + i / 4 * 3);
+#endif
+    const std::ptrdiff_t len = details::decode_scalar(src + i, size - i, dst + i / 4 * 3);
+    if (len < 0)
+      return false;
+    dst_size = i / 4 * 3 + static_cast<std::size_t>(len);
+    return true;
+  }
+
+  // encode in base64 a std::string
   inline std::string encode(const std::string& data)
   {
-    // convert in base64
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO* bio = BIO_new(BIO_s_mem());
-    bio = BIO_push(b64, bio);
-    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
-    BIO_write(bio, data.data(), static_cast<int>(data.size()));
-    BIO_flush(bio);
-
-    // extract data from buffer to std::string
-    BUF_MEM* buf = nullptr;
-    BIO_get_mem_ptr(bio, &buf);
-    std::string base64_str(buf->data, buf->length);
-
-    // free BIOs memory
-    BIO_free_all(bio);
-    return base64_str;
+    std::string str(encoded_size(data.size()), '\0');
+    encode(reinterpret_cast<const unsigned char*>(data.data()), data.size(), str.data());
+    return str;
   }
 
-  // decode a base64 std::string into a std::vector<unsigned char> using openssl
-  std::vector<unsigned char> decode(const std::string& data)
+  // decode a base64 std::string into a std::vector<unsigned char> - empty if invalid
+  inline std::vector<unsigned char> decode(const std::string& data)
   {
-    // convert from base64
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO* bio = BIO_new_mem_buf(data.c_str(), data.size());
-    bio = BIO_push(b64, bio);
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-
-    // decode base64
-    const int buf_len = 1024;
-    char buffer[buf_len];
-    std::vector<unsigned char> buf;
-    while (true)
-    {
-      const int bytes = BIO_read(bio, buffer, buf_len);
-      if (bytes > 0)
-        buf.insert(buf.end(), buffer, buffer + bytes);
-      else
-        break;
-    }
-
-    // free BIOs memory
-    BIO_free_all(bio);
+    std::vector<unsigned char> buf(decoded_size(data.size()));
+    std::size_t size = 0;
+    if (!decode(data.data(), data.size(), buf.data(), size))
+      return {};
+    buf.resize(size);
     return buf;
   }
-}
\ No newline at end of file
+}
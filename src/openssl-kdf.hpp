@@ -0,0 +1,277 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <openssl/kdf.h>
+#include <openssl/params.h>
+#include <openssl/opensslv.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+#include <openssl/thread.h>
+#endif
+
+namespace kdf
+{
+  // derive a key using PBKDF2-HMAC-SHA256
+  inline const std::vector<unsigned char> pbkdf2_sha256(const std::string& password,
+                                                        const std::vector<unsigned char>& salt,
+                                                        const std::size_t iterations,
+                                                        const std::size_t key_size)
+  {
+    std::vector<unsigned char> key(key_size, 0);
+    if (PKCS5_PBKDF2_HMAC(password.c_str(), static_cast<int>(password.size()),
+                          salt.data(), static_cast<int>(salt.size()),
+                          static_cast<int>(iterations),
+                          EVP_sha256(),
+                          static_cast<int>(key.size()), key.data()) != 1)
+      throw std::runtime_error("can't derive key using pbkdf2-sha256 algorithm");
+    return key;
+  }
+
+  // derive a key using Argon2id (requires openssl >= 3.2)
+  //  memory cost is expressed in KiB
+  inline const std::vector<unsigned char> argon2id(const std::string& password,
+                                                   const std::vector<unsigned char>& salt,
+                                                   const std::size_t iterations,
+                                                   const std::size_t memory_kib,
+                                                   const std::size_t parallelism,
+                                                   const std::size_t key_size)
+  {
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+    EVP_KDF* kdf = EVP_KDF_fetch(nullptr, "ARGON2ID", nullptr);
+    EVP_KDF_CTX* ctx = kdf ? EVP_KDF_CTX_new(kdf) : nullptr;
+    EVP_KDF_free(kdf);
+    if (!ctx)
+      throw std::runtime_error("can't initialize the openssl argon2id context");
+
+    // let openssl use one thread per lane
+    uint32_t iter = static_cast<uint32_t>(iterations);
+    uint32_t memcost = static_cast<uint32_t>(memory_kib);
+    uint32_t lanes = static_cast<uint32_t>(parallelism);
+    uint32_t threads = lanes;
+    if (OSSL_set_max_threads(nullptr, threads) != 1)
+      threads = 1;
+    OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_octet_string("pass", const_cast<char*>(password.data()), password.size()),
+      OSSL_PARAM_construct_octet_string("salt", const_cast<unsigned char*>(salt.data()), salt.size()),
+      OSSL_PARAM_construct_uint32("iter", &iter),
+      OSSL_PARAM_construct_uint32("memcost", &memcost),
+      OSSL_PARAM_construct_uint32("lanes", &lanes),
+      OSSL_PARAM_construct_uint32("threads", &threads),
+      OSSL_PARAM_construct_end()
+    };
+
+    // execute the derivation
+    std::vector<unsigned char> key(key_size, 0);
+    const int res = EVP_KDF_derive(ctx, key.data(), key.size(), params);
+    EVP_KDF_CTX_free(ctx);
+    if (res != 1)
+      throw std::runtime_error("can't derive key using argon2id algorithm");
+    return key;
+#else
+    static_cast<void>(password);
+    static_cast<void>(salt);
+    static_cast<void>(iterations);
+    static_cast<void>(memory_kib);
+    static_cast<void>(parallelism);
+    static_cast<void>(key_size);
+    throw std::runtime_error("argon2id algorithm requires openssl 3.2 or later");
+#endif
+  }
+
+  // expand a pseudo-random key using HKDF-SHA256 (expand step only)
+  inline const std::vector<unsigned char> hkdf_expand_sha256(const std::vector<unsigned char>& prk,
+                                                             const std::string& info,
+                                                             const std::size_t key_size)
+  {
+    std::vector<unsigned char> key;
+    std::vector<unsigned char> block;
+    for (unsigned char counter = 1; key.size() < key_size; ++counter)
+    {
+      // T(n) = HMAC(PRK, T(n-1) | info | n)
+      std::vector<unsigned char> data(block);
+      data.insert(data.end(), info.begin(), info.end());
+      data.push_back(counter);
+      block.assign(EVP_MAX_MD_SIZE, 0);
+      unsigned int len = 0;
+      if (!HMAC(EVP_sha256(), prk.data(), static_cast<int>(prk.size()), data.data(), data.size(), block.data(), &len))
+        throw std::runtime_error("can't expand key using hkdf-sha256 algorithm");
+      block.resize(len);
+      key.insert(key.end(), block.begin(), block.end());
+    }
+    key.resize(key_size);
+    return key;
+  }
+
+  // settings of the derivation of the QR Codes cipher key from the password
+  //  sha256:         unsalted SHA-256 of the password - the key can be computed by any sha-256 tool
+  //  pbkdf2-sha256:  salted PBKDF2-HMAC-SHA256 with a number of iterations
+  //  argon2id:       salted Argon2id with a number of iterations, a memory cost in KiB and lanes
+  struct params
+  {
+    std::string algorithm = "sha256";
+    std::size_t iterations = 0;
+    std::size_t memory_kib = 0;
+    std::size_t parallelism = 0;
+    std::vector<unsigned char> salt;
+  };
+
+  // size in bytes of the generated salts
+  constexpr std::size_t salt_size = 16;
+
+  // get the settings of a key derivation algorithm - 0 selects the default cost
+  //  defaults: 600000 iterations for pbkdf2-sha256, 3 iterations of 64 MiB on 4 lanes for argon2id
+  inline struct params get_params(const std::string& algorithm,
+                                  const std::size_t iterations,
+                                  const std::size_t memory_kib)
+  {
+    struct params p;
+    p.algorithm = algorithm;
+    if (algorithm == "pbkdf2-sha256")
+      p.iterations = iterations ? iterations : 600000;
+    else if (algorithm == "argon2id")
+    {
+      p.iterations = iterations ? iterations : 3;
+      p.memory_kib = memory_kib ? memory_kib : 64 * 1024;
+      p.parallelism = 4;
+      if (p.memory_kib < 8 * p.parallelism)
+        throw std::runtime_error(fmt::format("invalid argon2id memory cost: {} KiB (should be >= {})", p.memory_kib, 8 * p.parallelism));
+    }
+    else if (algorithm != "sha256")
+      throw std::runtime_error(fmt::format("invalid kdf: \"{}\"", algorithm));
+    return p;
+  }
+
+  // check if the algorithm needs a salt
+  inline bool is_salted(const struct params& p)
+  {
+    return p.algorithm != "sha256";
+  }
+
+  // generate a random salt
+  inline const std::vector<unsigned char> generate_salt()
+  {
+    std::vector<unsigned char> salt(salt_size, 0);
+    if (RAND_bytes(salt.data(), static_cast<int>(salt.size())) != 1)
+      throw std::runtime_error("can't generate random salt buf");
+    return salt;
+  }
+
+  // derive a deterministic salt from a seed - the same seed always gives the same salt
+  inline const std::vector<unsigned char> derive_salt(const std::string& seed)
+  {
+    const std::string& str = "bw2qr-salt:" + seed;
+    std::vector<unsigned char> salt(SHA256_DIGEST_LENGTH, 0);
+    SHA256(reinterpret_cast<const unsigned char*>(str.data()), str.size(), salt.data());
+    salt.resize(salt_size);
+    return salt;
+  }
+
+  // derive a key from the password
+  inline const std::vector<unsigned char> derive(const std::string& password,
+                                                 const struct params& p,
+                                                 const std::size_t key_size)
+  {
+    if (p.algorithm == "pbkdf2-sha256")
+      return pbkdf2_sha256(password, p.salt, p.iterations, key_size);
+    if (p.algorithm == "argon2id")
+      return argon2id(password, p.salt, p.iterations, p.memory_kib, p.parallelism, key_size);
+    if (key_size != SHA256_DIGEST_LENGTH)
+      throw std::runtime_error(fmt::format("invalid sha256 key size: {}", key_size));
+    std::vector<unsigned char> key(SHA256_DIGEST_LENGTH, 0);
+    SHA256(reinterpret_cast<const unsigned char*>(password.data()), password.size(), key.data());
+    return key;
+  }
+
+  // adjust the cost of the derivation to take the target duration on this machine
+  //  pbkdf2-sha256: the iterations are scaled from a measured run of at least 50ms
+  //  argon2id:      the memory cost is kept and the iterations are scaled from a measured run
+  //                 the memory cost is halved while a single iteration exceeds the target
+  inline void calibrate(struct params& p, const std::chrono::milliseconds target)
+  {
+    if (!is_salted(p) || (target.count() <= 0))
+      return;
+    auto measure = [&](const struct params& m) -> double {
+      const auto start = std::chrono::steady_clock::now();
+      derive("bw2qr-calibration", m, 32);
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    struct params m(p);
+    m.salt.assign(salt_size, 0);
+    double duration = 0.0;
+    if (p.algorithm == "pbkdf2-sha256")
+    {
+      m.iterations = 10000;
+      while ((duration = measure(m)) < 50.0)
+        m.iterations *= 2;
+    }
+    else
+    {
+      m.iterations = 1;
+      while (((duration = measure(m)) > target.count()) && (m.memory_kib / 2 >= 8 * m.parallelism))
+        m.memory_kib /= 2;
+    }
+    p.memory_kib = m.memory_kib;
+    p.iterations = std::max<std::size_t>(1, static_cast<std::size_t>(m.iterations * target.count() / std::max(duration, 1e-3)));
+  }
+
+  // describe the settings of the derivation - documents how to restore the key
+  //  e.g.: pbkdf2-sha256:i=600000:salt=<hex> or argon2id:t=3:m=65536:p=4:salt=<hex>
+  inline std::string to_string(const struct params& p)
+  {
+    std::string salt_hex;
+    for (const auto& byte : p.salt)
+      salt_hex += fmt::format("{:02x}", byte);
+    if (p.algorithm == "pbkdf2-sha256")
+      return fmt::format("{}:i={}:salt={}", p.algorithm, p.iterations, salt_hex);
+    if (p.algorithm == "argon2id")
+      return fmt::format("{}:t={}:m={}:p={}:salt={}", p.algorithm, p.iterations, p.memory_kib, p.parallelism, salt_hex);
+    return p.algorithm;
+  }
+
+  // read the settings of the derivation described by to_string
+  inline struct params from_string(const std::string& str)
+  {
+    struct params p;
+    std::istringstream is(str);
+    std::string field;
+    if (!std::getline(is, p.algorithm, ':'))
+      throw std::runtime_error(fmt::format("invalid kdf settings: \"{}\"", str));
+    while (std::getline(is, field, ':'))
+    {
+      const std::size_t pos = field.find('=');
+      const std::string& name = field.substr(0, pos);
+      const std::string& value = (pos == std::string::npos) ? "" : field.substr(pos + 1);
+      try
+      {
+        if ((name == "i") || (name == "t"))
+          p.iterations = std::stoul(value);
+        else if (name == "m")
+          p.memory_kib = std::stoul(value);
+        else if (name == "p")
+          p.parallelism = std::stoul(value);
+        else if ((name == "salt") && (value.size() % 2 == 0))
+          for (std::size_t i = 0; i < value.size(); i += 2)
+            p.salt.push_back(static_cast<unsigned char>(std::stoul(value.substr(i, 2), nullptr, 16)));
+        else
+          throw std::invalid_argument(name);
+      }
+      catch (const std::exception&)
+      {
+        throw std::runtime_error(fmt::format("invalid kdf settings: \"{}\"", str));
+      }
+    }
+    if ((p.algorithm != "sha256") && (p.algorithm != "pbkdf2-sha256") && (p.algorithm != "argon2id"))
+      throw std::runtime_error(fmt::format("invalid kdf settings: \"{}\"", str));
+    return p;
+  }
+}
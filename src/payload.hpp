@@ -0,0 +1,179 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include "bitwarden-reader.hpp"
+
+namespace payload
+{
+  using json = nlohmann::ordered_json;
+
+  // encoding of the QR Code data
+  enum class format
+  {
+    json,     // indented json with long keys
+    compact,  // minified json with short keys
+    cbor,     // short keys schema encoded in CBOR
+    msgpack   // short keys schema encoded in MessagePack
+  };
+
+  // convert the name of a payload format into a format
+  inline format get_format(const std::string& name)
+  {
+    if (name == "json")     return format::json;
+    if (name == "compact")  return format::compact;
+    if (name == "cbor")     return format::cbor;
+    if (name == "msgpack")  return format::msgpack;
+    throw std::runtime_error(fmt::format("invalid payload format: \"{}\"", name));
+  }
+
+  // check if the payload format produces binary data
+  inline bool is_binary(const format fmt)
+  {
+    return (fmt == format::cbor) || (fmt == format::msgpack);
+  }
+
+  // serialize the QR Code data of an item directly into a reusable buffer
+  //  json: same layout as the indented json dump with one-line field objects:
+  //  {
+  //    "login": {
+  //      "username": "...",
+  //      "password": "...",
+  //      "totp": "..."
+  //    },
+  //    "fields": [
+  //      { "name": "value" }
+  //    ]
+  //  }
+  //  compact/cbor/msgpack: short keys schema where empty values are omitted:
+  //  {"l":{"u":"...","p":"...","t":"..."},"f":[{"name":"value"}]}
+  class writer final
+  {
+  public:
+    // constructor/destructor
+    writer() = default;
+    ~writer() = default;
+
+    // serialize the item - the returned buffer is reused by the next call
+    const std::string& write(const struct bitwarden::item& item, const format fmt = format::json)
+    {
+      m_buffer.clear();
+      switch (fmt)
+      {
+      case format::compact: write_compact(item); break;
+      case format::cbor:    json::to_cbor(get_short_keys(item), m_buffer); break;
+      case format::msgpack: json::to_msgpack(get_short_keys(item), m_buffer); break;
+      default:              write_json(item); break;
+      }
+      return m_buffer;
+    }
+
+  private:
+    // write the indented json layout
+    void write_json(const struct bitwarden::item& item)
+    {
+      m_buffer += "{\n  \"login\": {\n    \"username\": ";
+      add_string(item.username);
+      m_buffer += ",\n    \"password\": ";
+      add_string(item.password);
+      m_buffer += ",\n    \"totp\": ";
+      add_string(item.totp);
+      m_buffer += "\n  },\n  \"fields\": [";
+      if (item.fields.empty())
+        m_buffer += "]\n}";
+      else
+      {
+        for (std::size_t i = 0; i < item.fields.size(); ++i)
+        {
+          m_buffer += i ? ",\n    { " : "\n    { ";
+          add_string(item.fields[i].name);
+          m_buffer += ": ";
+          add_string(item.fields[i].value);
+          m_buffer += " }";
+        }
+        m_buffer += "\n  ]\n}";
+      }
+    }
+
+    // write the minified json layout with short keys
+    void write_compact(const struct bitwarden::item& item)
+    {
+      m_buffer += "{\"l\":{";
+      const std::size_t login_pos = m_buffer.size();
+      auto add_login = [&](const char* key, const std::string& value) {
+        if (value.empty())
+          return;
+        if (m_buffer.size() != login_pos)
+          m_buffer += ',';
+        m_buffer += key;
+        add_string(value);
+      };
+      add_login("\"u\":", item.username);
+      add_login("\"p\":", item.password);
+      add_login("\"t\":", item.totp);
+      m_buffer += '}';
+      for (std::size_t i = 0; i < item.fields.size(); ++i)
+      {
+        m_buffer += i ? ",{" : ",\"f\":[{";
+        add_string(item.fields[i].name);
+        m_buffer += ':';
+        add_string(item.fields[i].value);
+        m_buffer += '}';
+      }
+      m_buffer += item.fields.empty() ? "}" : "]}";
+    }
+
+    // create the short keys schema used by the binary formats
+    static json get_short_keys(const struct bitwarden::item& item)
+    {
+      json obj;
+      obj["l"] = json::object();
+      if (!item.username.empty())
+        obj["l"]["u"] = item.username;
+      if (!item.password.empty())
+        obj["l"]["p"] = item.password;
+      if (!item.totp.empty())
+        obj["l"]["t"] = item.totp;
+      for (const auto& field : item.fields)
+        obj["f"].push_back({ { field.name, field.value } });
+      return obj;
+    }
+
+    // add a quoted json string - escaped as nlohmann::json::dump does
+    void add_string(const std::string_view str)
+    {
+      static const char hex[] = "0123456789abcdef";
+      m_buffer += '"';
+      for (const char c : str)
+      {
+        switch (c)
+        {
+        case '"':  m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\b': m_buffer += "\\b";  break;
+        case '\f': m_buffer += "\\f";  break;
+        case '\n': m_buffer += "\\n";  break;
+        case '\r': m_buffer += "\\r";  break;
+        case '\t': m_buffer += "\\t";  break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20)
+          {
+            m_buffer += "\\u00";
+            m_buffer += hex[(c >> 4) & 0x0f];
+            m_buffer += hex[c & 0x0f];
+          }
+          else
+            m_buffer += c;
+          break;
+        }
+      }
+      m_buffer += '"';
+    }
+
+  private:
+    std::string m_buffer;
+  };
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+#include <system_error>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#pragma warning( push )
+#pragma warning( disable: 4005 )
+#include <podofo/podofo.h>
+#pragma warning( pop )
+#include "QrCode.h"
+#include "mapped-file.hpp"
+
+namespace pdf
+{
+  // place the QR Codes on A4 pdf pages as soon as they are ready - resolution: 150dpi
+  //  the document is streamed: each image is written to the output when it is added
+  //  pages are created when their first QR Code is added, along with the footers QR Codes
+  //  a reproducible document has fixed dates: the same QR Codes give the same bytes
+  //  it is kept in memory until closed, the trailer ID being a hash of the dates known once the writer is created
+  //  the document is written to a temporary file next to the pdf and renamed over it once complete:
+  //  an existing pdf is only replaced by a complete one
+  class writer final
+  {
+    // delete copy/assignement operators
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    writer(writer&&) = delete;
+    writer& operator=(writer&&) = delete;
+
+  public:
+    // constructor/destructor
+    //  the pdf is written to standard output if the path is "-"
+    writer(const std::filesystem::path& path,
+           const std::size_t cols,
+           const std::size_t rows,
+           const std::vector<struct qr::PngImage>& footers,
+           const bool reproducible = false) :
+      m_path(path),
+      m_tmp_path(path == "-" ? std::filesystem::path() : std::filesystem::path(path).concat(".tmp")),
+      m_cols(cols),
+      m_rows(rows),
+      m_footers(footers),
+      m_reproducible(reproducible)
+    {
+      // skip invalid parameters
+      if (!m_cols || !m_rows)
+        throw std::runtime_error(fmt::format("invalid number of rows: {} or columns: {}", m_rows, m_cols));
+
+      // get the size of the A4 pages
+      const PoDoFo::PdfRect& rect = PoDoFo::PdfPage::CreateStandardPageSize(PoDoFo::ePdfPageSize_A4);
+      m_page_width = rect.GetWidth();
+      m_page_height = rect.GetHeight();
+      if (!m_page_width || !m_page_height)
+        throw std::runtime_error(fmt::format("invalid pdf page width: {} or height: {}", m_page_width, m_page_height));
+
+      // create the pdf document and disable debugging informations
+      PoDoFo::PdfError::EnableDebug(false);
+      if (m_path == "-")
+      {
+        io::set_binary_mode(stdout);
+        m_device = std::make_unique<PoDoFo::PdfOutputDevice>(&std::cout);
+      }
+      else if (std::filesystem::exists(m_path))
+      {
+        // check that the pdf can be replaced - without truncating it
+        std::ofstream file(m_path, std::ios::binary | std::ios::app);
+        if (!file.is_open())
+          throw std::runtime_error(fmt::format("can't write to file: \"{}\" - already open?", m_path.u8string()));
+      }
+
+      // a streamed document hashes its info dictionary in the trailer ID as soon as it is created
+      //  the reproducible document is only written by close(): its ID is computed from the fixed dates
+      //  the objects are numbered in the order of the QR Codes which doesn't depend on the threads
+      if (m_reproducible)
+      {
+        m_pdf = std::make_unique<PoDoFo::PdfMemDocument>();
+        PoDoFo::PdfDictionary& info = m_pdf->GetInfo()->GetObject()->GetDictionary();
+        info.AddKey(PoDoFo::PdfName("CreationDate"), PoDoFo::PdfString(m_reproducible_date));
+        info.AddKey(PoDoFo::PdfName("ModDate"), PoDoFo::PdfString(m_reproducible_date));
+      }
+      else if (m_device)
+        m_pdf = std::make_unique<PoDoFo::PdfStreamedDocument>(m_device.get());
+      else
+        m_pdf = std::make_unique<PoDoFo::PdfStreamedDocument>(m_tmp_path.string().c_str());
+    }
+    ~writer()
+    {
+      // remove the incomplete temporary file - the existing pdf is left untouched
+      if (!m_closed)
+      {
+        m_pdf.reset();
+        if (!m_tmp_path.empty())
+        {
+          std::error_code ec;
+          std::filesystem::remove(m_tmp_path, ec);
+        }
+      }
+    }
+
+    // add the next entry QR Code
+    void add(const struct qr::PngImage& png)
+    {
+      if (!m_nb_entries)
+        init_layout(png);
+
+      // create the pdf page with its footers
+      const std::size_t qr_per_pages = m_cols * m_rows;
+      if (!(m_nb_entries % qr_per_pages))
+      {
+        m_page = m_pdf->CreatePage(PoDoFo::PdfPage::CreateStandardPageSize(PoDoFo::ePdfPageSize_A4));
+        if (!m_page)
+          throw std::runtime_error("can't create pdf page");
+        for (std::size_t f_idx = 0; f_idx < m_footers.size(); ++f_idx)
+        {
+          const double px = ((f_idx + 1) * m_margin_footer_width) + (f_idx * m_qr_footer_width);
+          const double py = m_page_height - ((m_rows * (m_qr_entry_height + m_margin_entry_height)) + m_qr_footer_height + m_margin_entry_height);
+          draw_png(m_footers[f_idx], px, py);
+        }
+      }
+
+      // draw the QR Code at its place in the page
+      const std::size_t idx_x = (m_nb_entries % qr_per_pages) % m_cols;
+      const std::size_t idx_y = (m_nb_entries % qr_per_pages) / m_cols;
+      const double px = ((idx_x + 1) * m_margin_entry_width) + (idx_x * m_qr_entry_width);
+      const double py = m_page_height - ((idx_y + 1) * (m_margin_entry_height + m_qr_entry_height));
+      draw_png(png, px, py);
+      ++m_nb_entries;
+    }
+
+    // finish writing the pdf document
+    void close()
+    {
+      if (!m_nb_entries)
+        throw std::runtime_error("no entry QR Codes to generate");
+      if (m_reproducible)
+      {
+        PoDoFo::PdfMemDocument& pdf = static_cast<PoDoFo::PdfMemDocument&>(*m_pdf);
+        if (m_device)
+          pdf.Write(m_device.get());
+        else
+          pdf.Write(m_tmp_path.string().c_str());
+      }
+      else
+        static_cast<PoDoFo::PdfStreamedDocument&>(*m_pdf).Close();
+      if (m_device)
+      {
+        m_device->Flush();
+        std::cout.flush();
+      }
+      else
+      {
+        // release the temporary file before replacing the pdf with it
+        m_pdf.reset();
+        std::error_code ec;
+        std::filesystem::rename(m_tmp_path, m_path, ec);
+        if (ec)
+          throw std::runtime_error(fmt::format("can't write to file: \"{}\" - {}", m_path.u8string(), ec.message()));
+      }
+      m_closed = true;
+    }
+
+  private:
+    // compute the layout of the pages from the size of the QR Codes
+    void init_layout(const struct qr::PngImage& png)
+    {
+      // get the size of entry and footer QR Codes images
+      m_qr_entry_width = png.width * m_scale;
+      m_qr_entry_height = png.height * m_scale;
+      m_qr_footer_width = m_footers.empty() ? 0 : m_footers.front().width * m_scale;
+      m_qr_footer_height = m_footers.empty() ? 0 : m_footers.front().height * m_scale;
+
+      // check that everything fits in the pdf page
+      if ((m_qr_entry_width * m_cols) > m_page_width)
+        throw std::runtime_error(fmt::format("can't place '{}' QR Codes of {}px width within: {}px of A4 page", m_cols, m_qr_entry_width, m_page_width));
+      if ((m_qr_entry_height * m_rows + m_qr_footer_height) > m_page_height)
+        throw std::runtime_error(fmt::format("can't place '{}' QR Codes of {}px height + {}px height within: {}px of A4 page", m_rows, m_qr_entry_height, m_qr_footer_height, m_page_height));
+
+      // calc margin size
+      m_margin_entry_width = (m_page_width - (m_cols * m_qr_entry_width)) / (m_cols + 1);
+      m_margin_entry_height = (m_page_height - (m_rows * m_qr_entry_height + m_qr_footer_height)) / (m_rows + 1 + (m_footers.empty() ? 0 : 1));
+      m_margin_footer_width = (m_page_width - (m_footers.size() * m_qr_footer_width)) / (m_footers.size() + 1);
+    }
+
+    // draw png image in the current pdf page
+    void draw_png(const struct qr::PngImage& png, const std::size_t px, const std::size_t py)
+    {
+      PoDoFo::PdfPainter painter;
+      painter.SetPage(m_page);
+      PoDoFo::PdfImage img(m_pdf.get());
+      img.LoadFromPngData(reinterpret_cast<const unsigned char*>(png.data.c_str()), png.data.size());
+      painter.DrawImage(px, py, &img, m_scale, m_scale);
+      painter.FinishPage();
+    }
+
+  private:
+    const double m_scale = 72.0 / 300.0 * 1.30;
+    const char* m_reproducible_date = "D:20000101000000Z";
+    std::filesystem::path m_path;
+    std::filesystem::path m_tmp_path;
+    std::size_t m_cols;
+    std::size_t m_rows;
+    std::vector<struct qr::PngImage> m_footers;
+    std::unique_ptr<PoDoFo::PdfOutputDevice> m_device;
+    std::unique_ptr<PoDoFo::PdfDocument> m_pdf;
+    PoDoFo::PdfPage* m_page = nullptr;
+    bool m_reproducible = false;
+    bool m_closed = false;
+    std::size_t m_nb_entries = 0;
+    std::size_t m_page_width = 0;
+    std::size_t m_page_height = 0;
+    std::size_t m_qr_entry_width = 0;
+    std::size_t m_qr_entry_height = 0;
+    std::size_t m_qr_footer_width = 0;
+    std::size_t m_qr_footer_height = 0;
+    std::size_t m_margin_entry_width = 0;
+    std::size_t m_margin_entry_height = 0;
+    std::size_t m_margin_footer_width = 0;
+  };
+}
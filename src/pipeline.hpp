@@ -0,0 +1,123 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+#include <condition_variable>
+
+namespace pipeline
+{
+  // blocking queue of bounded capacity connecting two stages of the pipeline
+  //  producers wait while the queue is full, consumers wait while it is empty
+  template<typename T>
+  class bounded_queue final
+  {
+    // delete copy/assignement operators
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+    bounded_queue(bounded_queue&&) = delete;
+    bounded_queue& operator=(bounded_queue&&) = delete;
+
+  public:
+    // constructor/destructor
+    explicit bounded_queue(const std::size_t capacity) :
+      m_capacity(std::max<std::size_t>(1, capacity))
+    {
+    }
+    ~bounded_queue() = default;
+
+    // push a value - returns false if the queue has been closed
+    bool push(T&& value)
+    {
+      std::unique_lock<std::mutex> lck(m_mutex);
+      m_not_full.wait(lck, [&]() { return m_closed || (m_queue.size() < m_capacity); });
+      if (m_closed)
+        return false;
+      m_queue.push_back(std::move(value));
+      m_not_empty.notify_one();
+      return true;
+    }
+
+    // pop a value - returns false once the queue is closed and empty
+    bool pop(T& value)
+    {
+      std::unique_lock<std::mutex> lck(m_mutex);
+      m_not_empty.wait(lck, [&]() { return m_closed || !m_queue.empty(); });
+      if (m_queue.empty())
+        return false;
+      value = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_not_full.notify_one();
+      return true;
+    }
+
+    // close the queue - wake up all the waiting stages
+    void close()
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      m_closed = true;
+      m_not_full.notify_all();
+      m_not_empty.notify_all();
+    }
+
+  private:
+    const std::size_t m_capacity;
+    std::deque<T> m_queue;
+    bool m_closed = false;
+    std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+  };
+
+  // window of the items in flight between the first and the last stage of the pipeline
+  //  the last stage releases the items in order: an item can only enter the pipeline
+  //  when it is within the window size of the last released one
+  //  so that the results waiting for the previous ones to be released stay bounded
+  class window final
+  {
+    // delete copy/assignement operators
+    window(const window&) = delete;
+    window& operator=(const window&) = delete;
+    window(window&&) = delete;
+    window& operator=(window&&) = delete;
+
+  public:
+    // constructor/destructor
+    explicit window(const std::size_t size) :
+      m_size(std::max<std::size_t>(1, size))
+    {
+    }
+    ~window() = default;
+
+    // wait until the item can enter the pipeline - returns false if cancelled
+    bool acquire(const std::size_t index)
+    {
+      std::unique_lock<std::mutex> lck(m_mutex);
+      m_cv.wait(lck, [&]() { return m_cancelled || (index < m_released + m_size); });
+      return !m_cancelled;
+    }
+
+    // the next item in order has left the pipeline
+    void release()
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      ++m_released;
+      m_cv.notify_all();
+    }
+
+    // stop the pipeline - wake up all the waiting stages
+    void cancel()
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      m_cancelled = true;
+      m_cv.notify_all();
+    }
+
+  private:
+    const std::size_t m_size;
+    std::size_t m_released = 0;
+    bool m_cancelled = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+  };
+}
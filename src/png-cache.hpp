@@ -0,0 +1,201 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <variant>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <type_traits>
+#include <initializer_list>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <openssl/sha.h>
+#include "QrCode.h"
+
+namespace cache
+{
+  // append a length-prefixed value to a fingerprint - avoids ambiguous concatenations
+  inline void add_value(std::string& str, const std::string& value)
+  {
+    str += fmt::format("{}:{};", value.size(), value);
+  }
+
+  // create the fingerprint of the QR Code stylesheet options
+  inline std::string get_fingerprint(const std::initializer_list<details::OptionsVal>& opts)
+  {
+    std::string str;
+    for (const auto& o : opts)
+    {
+      std::visit([&](const auto& opt) {
+        using T = std::decay_t<decltype(opt.arg)>;
+        add_value(str, details::option_name.at(opt.id));
+        if constexpr (std::is_same_v<T, std::string>)
+          add_value(str, opt.arg);
+        else if constexpr (std::is_same_v<T, qr::ecc>)
+          add_value(str, std::to_string(static_cast<int>(opt.arg)));
+        else
+          add_value(str, fmt::format("{}", opt.arg));
+        }, o);
+    }
+    return str;
+  }
+
+  // content-addressed cache of the verified QR Code png images
+  //  the key is the SHA-256 of everything used to render the image:
+  //  the fingerprint (program version, stylesheet) and the QR Code title, data, url and logo
+  //  the data is the encrypted one when a password is set: the cipher parameters are part of it
+  //  the least recently used images are evicted once the cache exceeds its maximum size
+  class png_cache final
+  {
+    // delete copy/assignement operators
+    png_cache(const png_cache&) = delete;
+    png_cache& operator=(const png_cache&) = delete;
+    png_cache(png_cache&&) = delete;
+    png_cache& operator=(png_cache&&) = delete;
+
+  public:
+    // constructor/destructor
+    png_cache(const std::filesystem::path& dir,
+              const std::size_t max_size,
+              const std::string& fingerprint) :
+      m_dir(dir),
+      m_max_size(max_size),
+      m_fingerprint(fingerprint)
+    {
+      std::error_code ec;
+      std::filesystem::create_directories(m_dir, ec);
+      if (!std::filesystem::is_directory(m_dir))
+        throw std::runtime_error(fmt::format("can't create cache directory: \"{}\"", m_dir.u8string()));
+    }
+    ~png_cache() = default;
+
+    // compute the key of a QR Code image
+    const std::string get_key(const std::string& title,
+                              const std::string& data,
+                              const std::string& url,
+                              const std::string& logo = {}) const
+    {
+      std::string str(m_fingerprint);
+      add_value(str, title);
+      add_value(str, data);
+      add_value(str, url);
+      add_value(str, logo);
+      unsigned char digest[SHA256_DIGEST_LENGTH];
+      SHA256(reinterpret_cast<const unsigned char*>(str.data()), str.size(), digest);
+      std::string key;
+      for (const auto& byte : digest)
+        key += fmt::format("{:02x}", byte);
+      return key;
+    }
+
+    // load a QR Code image from the cache - refresh its last use
+    bool load(const std::string& key, struct qr::PngImage& png)
+    {
+      const std::filesystem::path path = m_dir / (key + ".png");
+      std::ifstream file(path, std::ios::binary);
+      if (!file)
+      {
+        ++m_misses;
+        return false;
+      }
+      std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      file.close();
+
+      // read the image size from the png header: signature + IHDR chunk
+      static const std::string signature("\x89PNG\r\n\x1a\n", 8);
+      if ((data.size() < 24) || (data.compare(0, 8, signature) != 0) || (data.compare(12, 4, "IHDR") != 0))
+      {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        ++m_misses;
+        return false;
+      }
+      auto read_u32 = [&](const std::size_t pos) -> std::size_t {
+        return (static_cast<std::size_t>(static_cast<unsigned char>(data[pos])) << 24) |
+               (static_cast<std::size_t>(static_cast<unsigned char>(data[pos + 1])) << 16) |
+               (static_cast<std::size_t>(static_cast<unsigned char>(data[pos + 2])) << 8) |
+                static_cast<std::size_t>(static_cast<unsigned char>(data[pos + 3]));
+      };
+      png.width = read_u32(16);
+      png.height = read_u32(20);
+      png.data = std::move(data);
+
+      // the modification time is used as the last use time
+      std::error_code ec;
+      std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+      ++m_hits;
+      return true;
+    }
+
+    // store a QR Code image in the cache - written in a temporary file then renamed
+    void store(const std::string& key, const struct qr::PngImage& png)
+    {
+      const std::filesystem::path path = m_dir / (key + ".png");
+      const std::filesystem::path tmp = m_dir / fmt::format("{}.{:x}.tmp", key, std::hash<std::thread::id>()(std::this_thread::get_id()));
+      {
+        std::ofstream file(tmp, std::ios::binary);
+        if (!file)
+          return;
+        file.write(png.data.data(), png.data.size());
+        if (!file)
+        {
+          file.close();
+          std::error_code ec;
+          std::filesystem::remove(tmp, ec);
+          return;
+        }
+      }
+      std::error_code ec;
+      std::filesystem::rename(tmp, path, ec);
+      if (ec)
+        std::filesystem::remove(tmp, ec);
+    }
+
+    // remove the least recently used images until the cache fits in its maximum size
+    void evict()
+    {
+      struct cache_file
+      {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        std::uintmax_t size;
+      };
+      std::vector<struct cache_file> files;
+      std::uintmax_t total_size = 0;
+      std::error_code ec;
+      for (const auto& entry : std::filesystem::directory_iterator(m_dir, ec))
+      {
+        if (!entry.is_regular_file(ec) || (entry.path().extension() != ".png"))
+          continue;
+        const struct cache_file f = { entry.path(), entry.last_write_time(ec), entry.file_size(ec) };
+        total_size += f.size;
+        files.push_back(f);
+      }
+      std::sort(files.begin(), files.end(), [](const struct cache_file& a, const struct cache_file& b) {
+        return a.time < b.time;
+        });
+      for (const auto& f : files)
+      {
+        if (total_size <= m_max_size)
+          break;
+        if (std::filesystem::remove(f.path, ec))
+          total_size -= f.size;
+      }
+    }
+
+    // statistics of the cache
+    std::size_t hits() const { return m_hits; }
+    std::size_t misses() const { return m_misses; }
+
+  private:
+    std::filesystem::path m_dir;
+    std::size_t m_max_size;
+    std::string m_fingerprint;
+    std::atomic<std::size_t> m_hits{ 0 };
+    std::atomic<std::size_t> m_misses{ 0 };
+  };
+}
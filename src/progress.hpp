@@ -0,0 +1,124 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/color.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace progress
+{
+  // check if a stream is an interactive terminal
+  inline bool is_terminal(std::FILE* stream)
+  {
+#ifdef _WIN32
+    return _isatty(_fileno(stream)) != 0;
+#else
+    return isatty(fileno(stream)) != 0;
+#endif
+  }
+
+  // progress bar redrawn at a fixed rate by a reporter thread
+  //  the workers only increment an atomic counter: the terminal output stays out of their way
+  //  nothing is printed when the stream isn't a terminal
+  class reporter final
+  {
+    // delete copy/assignement operators
+    reporter(const reporter&) = delete;
+    reporter& operator=(const reporter&) = delete;
+    reporter(reporter&&) = delete;
+    reporter& operator=(reporter&&) = delete;
+
+  public:
+    // constructor/destructor
+    reporter(const std::string& label,
+             const std::size_t label_len,
+             const std::size_t total,
+             std::FILE* stream,
+             const std::chrono::milliseconds interval = std::chrono::milliseconds(100)) :
+      m_label(fmt::format(fmt::emphasis::bold, "{:<" + std::to_string(label_len) + "}", label + ": ")),
+      m_total(total),
+      m_stream(stream),
+      m_interval(interval)
+    {
+      if (is_terminal(m_stream))
+        m_thread = std::thread(&reporter::run, this);
+    }
+    ~reporter()
+    {
+      stop();
+    }
+
+    // an entry has been completed - safe to call from any thread
+    void tick()
+    {
+      m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // stop the reporter thread - draw the final state
+    void stop()
+    {
+      if (!m_thread.joinable())
+        return;
+      {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_stopped = true;
+      }
+      m_cv.notify_all();
+      m_thread.join();
+      draw(m_count.load(std::memory_order_relaxed));
+      fmt::print(m_stream, "\n");
+      std::fflush(m_stream);
+    }
+
+  private:
+    // redraw the bar when the counter has changed
+    void run()
+    {
+      std::size_t drawn = static_cast<std::size_t>(-1);
+      std::unique_lock<std::mutex> lck(m_mutex);
+      while (!m_stopped)
+      {
+        const std::size_t count = m_count.load(std::memory_order_relaxed);
+        if (count != drawn)
+        {
+          draw(count);
+          drawn = count;
+        }
+        m_cv.wait_for(lck, m_interval, [&]() { return m_stopped; });
+      }
+    }
+
+    // draw the bar on the current line
+    void draw(const std::size_t count) const
+    {
+      constexpr std::size_t width = 30;
+      const std::size_t done = std::min(count, m_total);
+      const std::size_t filled = m_total ? (done * width / m_total) : width;
+      const std::size_t percent = m_total ? (done * 100 / m_total) : 100;
+      fmt::print(m_stream, "\r{}[{}{}] {:>3}% ({}/{})", m_label, std::string(filled, '#'), std::string(width - filled, ' '), percent, done, m_total);
+      std::fflush(m_stream);
+    }
+
+  private:
+    const std::string m_label;
+    const std::size_t m_total;
+    std::FILE* m_stream;
+    const std::chrono::milliseconds m_interval;
+    std::atomic<std::size_t> m_count{ 0 };
+    bool m_stopped = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+  };
+}
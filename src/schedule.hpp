@@ -0,0 +1,344 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include "bitwarden-reader.hpp"
+
+namespace schedule
+{
+  using json = nlohmann::ordered_json;
+
+  namespace details
+  {
+    // read an environment variable - empty if not set
+    inline std::string get_env(const char* name)
+    {
+#if defined(_WIN32)
+      char* value = nullptr;
+      std::size_t size = 0;
+      if (_dupenv_s(&value, &size, name) || !value)
+        return "";
+      const std::string str(value);
+      std::free(value);
+      return str;
+#else
+      const char* value = std::getenv(name);
+      return value ? value : "";
+#endif
+    }
+  }
+
+  // path of the per-install secret of the history keys - in the local data directory of the user
+  inline std::filesystem::path get_history_key_file()
+  {
+#if defined(_WIN32)
+    std::filesystem::path dir = details::get_env("LOCALAPPDATA");
+#else
+    std::filesystem::path dir = details::get_env("XDG_DATA_HOME");
+    if (dir.empty() && !details::get_env("HOME").empty())
+      dir = std::filesystem::path(details::get_env("HOME")) / ".local" / "share";
+#endif
+    if (dir.empty())
+      dir = std::filesystem::temp_directory_path();
+    return dir / "bw2qr" / "schedule-history.key";
+  }
+
+  // order in which the entries are handed to the threads
+  enum class policy
+  {
+    fifo, // order of the pdf
+    lpt   // longest processing time first
+  };
+
+  // convert the name of a scheduling policy
+  inline policy get_policy(const std::string& name)
+  {
+    if (name == "fifo")
+      return policy::fifo;
+    if (name == "lpt")
+      return policy::lpt;
+    throw std::runtime_error(fmt::format("invalid schedule: \"{}\"", name));
+  }
+
+  // order the dispatch of the entries - returns their positions in the pdf
+  //  the pdf is written in order and only a window of entries can be in flight:
+  //  the largest entries go first within consecutive blocks of the window size
+  inline std::vector<std::size_t> get_dispatch_order(const std::vector<double>& costs,
+                                                     const std::size_t block_size,
+                                                     const policy p)
+  {
+    std::vector<std::size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (p == policy::lpt)
+    {
+      const std::size_t size = std::max<std::size_t>(1, block_size);
+      for (std::size_t begin = 0; begin < order.size(); begin += size)
+      {
+        const auto end = order.begin() + std::min(begin + size, order.size());
+        std::stable_sort(order.begin() + begin, end, [&](const std::size_t a, const std::size_t b) {
+          return costs[a] > costs[b];
+          });
+      }
+    }
+    return order;
+  }
+
+  // ideal makespan of the jobs on a number of threads: perfectly balanced or bound by the longest job
+  inline double get_ideal_makespan(const std::vector<double>& durations, const std::size_t nb_threads)
+  {
+    if (durations.empty())
+      return 0.0;
+    const double total = std::accumulate(durations.begin(), durations.end(), 0.0);
+    return std::max(total / std::max<std::size_t>(1, nb_threads), *std::max_element(durations.begin(), durations.end()));
+  }
+
+  // number of threads used to generate the QR Codes
+  struct thread_budget
+  {
+    std::size_t jobs = 1;            // entries processed in parallel
+    std::size_t magick_threads = 1;  // graphicsmagick threads per entry
+  };
+
+  // divide the cores between the entries and the graphicsmagick threads (0 = automatic)
+  //  entries scale better than the inner loops of graphicsmagick: use all the cores for the entries
+  //  and only give the remaining ones to graphicsmagick when there are fewer entries than cores
+  //  a speculative logo render runs two variants of each entry: it counts as two threads per entry
+  inline struct thread_budget get_thread_budget(const std::size_t nb_entries,
+                                                const std::size_t jobs,
+                                                const std::size_t magick_threads,
+                                                const bool speculative,
+                                                const std::size_t hardware_threads = std::thread::hardware_concurrency())
+  {
+    const std::size_t nb_cores = std::max<std::size_t>(1, hardware_threads);
+    const std::size_t variants = speculative ? 2 : 1;
+    struct thread_budget budget;
+    if (jobs)
+      budget.jobs = jobs;
+    else if (magick_threads)
+      budget.jobs = std::max<std::size_t>(1, nb_cores / (magick_threads * variants));
+    else
+      budget.jobs = std::max<std::size_t>(1, nb_cores / variants);
+    budget.jobs = std::max<std::size_t>(1, std::min(budget.jobs, nb_entries));
+    budget.magick_threads = magick_threads ? magick_threads : std::max<std::size_t>(1, nb_cores / (budget.jobs * variants));
+    return budget;
+  }
+
+  // limit of a per-thread setting such as the OpenMP team size of graphicsmagick
+  //  omp_set_num_threads only changes the setting of its calling thread: the limit is recorded once
+  //  and each thread which renders applies it to itself, the other threads keep their default
+  class thread_limit final
+  {
+    // delete copy/assignement operators
+    thread_limit(const thread_limit&) = delete;
+    thread_limit& operator=(const thread_limit&) = delete;
+    thread_limit(thread_limit&&) = delete;
+    thread_limit& operator=(thread_limit&&) = delete;
+
+  public:
+    // constructor/destructor
+    explicit thread_limit(std::function<void(const std::size_t)> apply) : m_apply(std::move(apply)) {}
+    ~thread_limit() = default;
+
+    // record the limit - 0 leaves the threads to their default
+    void set(const std::size_t limit) { m_limit = limit; }
+    std::size_t get() const { return m_limit; }
+
+    // apply the limit to the calling thread
+    void apply() const
+    {
+      const std::size_t limit = m_limit;
+      if (limit)
+        m_apply(limit);
+    }
+
+  private:
+    std::function<void(const std::size_t)> m_apply;
+    std::atomic<std::size_t> m_limit{ 0 };
+  };
+
+  // cost model of the entries in seconds
+  //  entries measured by a previous run use their duration from the history file
+  //  others are estimated from their properties: title length (font metrics iterations),
+  //  payload size, logo and encryption - scaled to the durations of the history
+  //  the entries of the history are keyed by an HMAC under a per-install secret kept out of the history:
+  //  the history alone can't be used to test a guessed name or url
+  class cost_model final
+  {
+    // delete copy/assignement operators
+    cost_model(const cost_model&) = delete;
+    cost_model& operator=(const cost_model&) = delete;
+    cost_model(cost_model&&) = delete;
+    cost_model& operator=(cost_model&&) = delete;
+
+  public:
+    // constructor/destructor
+    //  the history is disabled if the path is empty, the secret is created on first use
+    cost_model(const std::filesystem::path& history_file,
+               const bool logo,
+               const bool encrypted,
+               const std::filesystem::path& key_file = get_history_key_file()) :
+      m_history_file(history_file),
+      m_logo(logo),
+      m_encrypted(encrypted)
+    {
+      if (m_history_file.empty())
+        return;
+      load_key(key_file);
+
+      // an unreadable history is ignored: it only affects the order of the entries
+      if (!std::filesystem::exists(m_history_file))
+        return;
+      std::ifstream file(m_history_file, std::ios::binary);
+      const json& root = json::parse(file, nullptr, false);
+      if (!root.is_object() || (root.value("version", 0) != m_version) || !root.contains("durations") || !root["durations"].is_object())
+        return;
+      for (const auto& [key, value] : root["durations"].items())
+        if (value.is_number())
+          m_durations[key] = value.get<double>();
+    }
+    ~cost_model()
+    {
+      OPENSSL_cleanse(m_mac_key.data(), m_mac_key.size());
+    }
+
+    // compute the costs of the entries in the given order
+    std::vector<double> get_costs(const std::vector<struct bitwarden::item>& items,
+                                  const std::vector<std::size_t>& order) const
+    {
+      // scale the estimates to the measured durations
+      std::vector<double> costs(order.size());
+      std::vector<bool> measured(order.size(), false);
+      double total_measured = 0.0;
+      double total_estimated = 0.0;
+      for (std::size_t i = 0; i < order.size(); ++i)
+      {
+        const struct bitwarden::item& item = items[order[i]];
+        costs[i] = estimate(item);
+        const auto it = m_durations.empty() ? m_durations.end() : m_durations.find(get_key(item));
+        if (it != m_durations.end())
+        {
+          total_measured += it->second;
+          total_estimated += costs[i];
+          costs[i] = it->second;
+          measured[i] = true;
+        }
+      }
+      if ((total_measured > 0.0) && (total_estimated > 0.0))
+        for (std::size_t i = 0; i < costs.size(); ++i)
+          if (!measured[i])
+            costs[i] *= total_measured / total_estimated;
+      return costs;
+    }
+
+    // record the duration of an entry - smoothed with the previous runs
+    //  only for the rendered entries: the images reused from the journal or the cache take no time
+    void update(const struct bitwarden::item& item, const double duration)
+    {
+      if (m_history_file.empty())
+        return;
+      const std::string& key = get_key(item);
+      const auto it = m_durations.find(key);
+      m_durations[key] = (it == m_durations.end()) ? duration : (it->second + duration) / 2.0;
+    }
+
+    // write the history file - written in a temporary file then renamed
+    void save() const
+    {
+      if (m_history_file.empty())
+        return;
+      json root = json::object();
+      root["version"] = m_version;
+      root["durations"] = json::object();
+      for (const auto& [key, duration] : m_durations)
+        root["durations"][key] = duration;
+      std::filesystem::path tmp(m_history_file);
+      tmp += ".tmp";
+      {
+        std::ofstream file(tmp, std::ios::binary);
+        if (!(file << root.dump()))
+          throw std::runtime_error(fmt::format("can't write schedule history file: \"{}\"", m_history_file.u8string()));
+      }
+      std::error_code ec;
+      std::filesystem::rename(tmp, m_history_file, ec);
+      if (ec)
+      {
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error(fmt::format("can't write schedule history file: \"{}\"", m_history_file.u8string()));
+      }
+    }
+
+  private:
+    // read the secret of the history keys - create it if missing, readable by the user only
+    void load_key(const std::filesystem::path& key_file)
+    {
+      m_mac_key.resize(32);
+      {
+        std::ifstream file(key_file, std::ios::binary);
+        if (file && file.read(reinterpret_cast<char*>(m_mac_key.data()), m_mac_key.size()))
+          return;
+      }
+      if (RAND_bytes(m_mac_key.data(), static_cast<int>(m_mac_key.size())) != 1)
+        throw std::runtime_error("can't generate the schedule history key");
+      std::error_code ec;
+      std::filesystem::create_directories(key_file.parent_path(), ec);
+      std::ofstream file(key_file, std::ios::binary | std::ios::trunc);
+      std::filesystem::permissions(key_file, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write, ec);
+      if (!file || !file.write(reinterpret_cast<const char*>(m_mac_key.data()), m_mac_key.size()))
+        throw std::runtime_error(fmt::format("can't write schedule history key file: \"{}\"", key_file.u8string()));
+    }
+
+    // estimate the cost of an entry from its properties
+    double estimate(const struct bitwarden::item& item) const
+    {
+      std::size_t payload_size = item.username.size() + item.password.size() + item.totp.size() + item.uri.size();
+      for (const auto& f : item.fields)
+        payload_size += f.name.size() + f.value.size();
+      return 0.05 +
+             0.002 * item.name.size() +
+             0.00005 * payload_size +
+             ((m_logo && !item.uri.empty()) ? 0.05 : 0.0) +
+             (m_encrypted ? 0.001 : 0.0);
+    }
+
+    // key of an entry in the history: HMAC-SHA256 of its name and url - the names aren't stored
+    std::string get_key(const struct bitwarden::item& item) const
+    {
+      const std::string& str = fmt::format("{}:{};{}:{};", item.name.size(), item.name, item.uri.size(), item.uri);
+      unsigned char digest[EVP_MAX_MD_SIZE];
+      unsigned int len = 0;
+      if (!HMAC(EVP_sha256(), m_mac_key.data(), static_cast<int>(m_mac_key.size()),
+                reinterpret_cast<const unsigned char*>(str.data()), str.size(), digest, &len))
+        throw std::runtime_error("can't compute the schedule history key of the entry");
+      std::string key;
+      for (unsigned int i = 0; i < len; ++i)
+        key += fmt::format("{:02x}", digest[i]);
+      return key;
+    }
+
+  private:
+    static constexpr int m_version = 2;
+    std::filesystem::path m_history_file;
+    std::vector<unsigned char> m_mac_key;
+    bool m_logo;
+    bool m_encrypted;
+    std::unordered_map<std::string, double> m_durations;
+  };
+}
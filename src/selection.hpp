@@ -0,0 +1,244 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <regex>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include "bitwarden-reader.hpp"
+#include "bitwarden-crypto.hpp"
+
+namespace selection
+{
+  using json = nlohmann::ordered_json;
+
+  // filter of the bitwarden items compiled from an expression
+  //  terms are separated by ';' and must all match: "type=login;folder=Work|Personal;name~^bank"
+  //  each term is "key=values", "key!=values" (values separated by '|') or "key~regex"
+  //  keys: type (login, note, card, identity or number), favorite (true or false),
+  //        folder (folder name - empty for no folder), collection (collection name),
+  //        organization (organization id - empty for personal items), name (item name)
+  //  the folders and collections may be listed after the items: their terms then accept every item
+  //  until the whole export is indexed, the provisionally selected items are filtered again afterwards
+  class filter final
+  {
+    // kind of item property tested by a term
+    enum class property { type, favorite, folder, collection, organization, name };
+
+    // compiled term of the expression
+    struct term
+    {
+      property prop = property::name;
+      bool negate = false;
+      std::vector<std::string> values;
+      std::optional<std::regex> pattern;
+      std::unordered_set<std::string> ids;
+      std::unordered_set<int> types;
+      bool favorite = false;
+      bool indexed = false;
+    };
+
+  public:
+    // constructor/destructor
+    explicit filter(const std::string& expression)
+    {
+      std::size_t pos = 0;
+      while (pos <= expression.size())
+      {
+        const std::size_t end = std::min(expression.find(';', pos), expression.size());
+        const std::string& str = expression.substr(pos, end - pos);
+        pos = end + 1;
+        if (!str.empty())
+          m_terms.push_back(compile(str));
+      }
+    }
+    ~filter() = default;
+
+    // build the hash indexes of the folders and collections names of the export
+    //  names of an account restricted export are decrypted using its key
+    //  before the end of the export (complete is false), a missing array may still follow the items:
+    //  its terms are left to the next call, otherwise it has no names
+    void index(const json& root,
+               const struct bitwarden::symmetric_key* key = nullptr,
+               const bool complete = true)
+    {
+      if (key)
+        m_key = *key;
+      const auto& folders = get_names(root, "folders");
+      const auto& collections = get_names(root, "collections");
+      for (auto& t : m_terms)
+      {
+        if ((t.prop != property::folder) && (t.prop != property::collection))
+          continue;
+        const char* array = (t.prop == property::folder) ? "folders" : "collections";
+        if (!complete && !root.contains(array))
+          continue;
+        const auto& names = (t.prop == property::folder) ? folders : collections;
+        t.indexed = true;
+        t.ids.clear();
+        if (t.pattern)
+        {
+          for (const auto& [name, ids] : names)
+            if (std::regex_search(name, *t.pattern))
+              t.ids.insert(ids.begin(), ids.end());
+          continue;
+        }
+        for (const auto& value : t.values)
+        {
+          if (value.empty())
+            continue;
+          const auto it = names.find(value);
+          if (it == names.end())
+            throw std::runtime_error(fmt::format("unknown {}: \"{}\"", (t.prop == property::folder) ? "folder" : "collection", value));
+          t.ids.insert(it->second.begin(), it->second.end());
+        }
+      }
+    }
+
+    // check if the folders and collections of every term are indexed
+    //  otherwise the selected items have to be filtered again once the whole export is indexed
+    bool indexed() const
+    {
+      return std::all_of(m_terms.begin(), m_terms.end(), [](const struct term& t) {
+        return t.indexed || ((t.prop != property::folder) && (t.prop != property::collection));
+        });
+    }
+
+    // check if an item is selected - only its header properties are used
+    //  the terms which aren't indexed yet accept every item
+    bool operator()(const struct bitwarden::item& item) const
+    {
+      for (const auto& t : m_terms)
+        if (((t.prop != property::folder) && (t.prop != property::collection)) || t.indexed)
+          if (match(t, item) == t.negate)
+            return false;
+      return true;
+    }
+
+  private:
+    // parse a term of the expression
+    static struct term compile(const std::string& str)
+    {
+      const std::size_t op = str.find_first_of("!=~");
+      if ((op == std::string::npos) || !op ||
+          ((str[op] == '!') && ((op + 1 >= str.size()) || (str[op + 1] != '='))))
+        throw std::runtime_error(fmt::format("invalid filter term: \"{}\"", str));
+      const std::string& key = str.substr(0, op);
+      const std::string& value = str.substr(op + ((str[op] == '!') ? 2 : 1));
+
+      struct term t;
+      if (key == "type")              t.prop = property::type;
+      else if (key == "favorite")     t.prop = property::favorite;
+      else if (key == "folder")       t.prop = property::folder;
+      else if (key == "collection")   t.prop = property::collection;
+      else if (key == "organization") t.prop = property::organization;
+      else if (key == "name")         t.prop = property::name;
+      else
+        throw std::runtime_error(fmt::format("invalid filter key: \"{}\"", key));
+      t.negate = (str[op] == '!');
+
+      // regex term - matched against names or ids
+      if (str[op] == '~')
+      {
+        if ((t.prop == property::type) || (t.prop == property::favorite))
+          throw std::runtime_error(fmt::format("invalid filter term: \"{}\" - regex not allowed for {}", str, key));
+        try
+        {
+          t.pattern = std::regex(value, std::regex::ECMAScript | std::regex::optimize);
+        }
+        catch (const std::regex_error& ex)
+        {
+          throw std::runtime_error(fmt::format("invalid filter regex: \"{}\" - {}", value, ex.what()));
+        }
+        return t;
+      }
+
+      // list of values
+      std::size_t pos = 0;
+      while (pos <= value.size())
+      {
+        const std::size_t end = std::min(value.find('|', pos), value.size());
+        t.values.push_back(value.substr(pos, end - pos));
+        pos = end + 1;
+      }
+      if (t.prop == property::type)
+      {
+        for (const auto& v : t.values)
+        {
+          if (v == "login")         t.types.insert(1);
+          else if (v == "note")     t.types.insert(2);
+          else if (v == "card")     t.types.insert(3);
+          else if (v == "identity") t.types.insert(4);
+          else if (!v.empty() && (v.find_first_not_of("0123456789") == std::string::npos))
+            t.types.insert(std::stoi(v));
+          else
+            throw std::runtime_error(fmt::format("invalid filter item type: \"{}\"", v));
+        }
+      }
+      else if (t.prop == property::favorite)
+      {
+        if ((t.values.size() != 1) || ((t.values[0] != "true") && (t.values[0] != "false")))
+          throw std::runtime_error(fmt::format("invalid filter favorite value: \"{}\"", value));
+        t.favorite = (t.values[0] == "true");
+      }
+      return t;
+    }
+
+    // map the names of the folders or collections to their ids
+    std::unordered_map<std::string, std::vector<std::string>> get_names(const json& root, const std::string& array) const
+    {
+      std::unordered_map<std::string, std::vector<std::string>> names;
+      if (!root.contains(array) || !root[array].is_array())
+        return names;
+      for (const auto& obj : root[array])
+      {
+        const std::string& id = bitwarden::details::get_field(obj, "id");
+        const std::string& name = bitwarden::details::get_field(obj, "name");
+        if (!id.empty())
+          names[(m_key && !name.empty()) ? bitwarden::decrypt(name, *m_key) : name].push_back(id);
+      }
+      return names;
+    }
+
+    // check if a term matches an item
+    bool match(const struct term& t, const struct bitwarden::item& item) const
+    {
+      switch (t.prop)
+      {
+      case property::type:
+        return t.types.count(item.type) != 0;
+      case property::favorite:
+        return item.favorite == t.favorite;
+      case property::folder:
+        if (item.folder_id.empty())
+          return !t.pattern && std::find(t.values.begin(), t.values.end(), "") != t.values.end();
+        return t.ids.count(item.folder_id) != 0;
+      case property::collection:
+        for (const auto& id : item.collection_ids)
+          if (t.ids.count(id))
+            return true;
+        return false;
+      case property::organization:
+        if (t.pattern)
+          return std::regex_search(item.organization_id, *t.pattern);
+        return std::find(t.values.begin(), t.values.end(), item.organization_id) != t.values.end();
+      default:
+      {
+        const std::string& name = (m_key && !item.name.empty()) ? bitwarden::decrypt(item.name, *m_key) : item.name;
+        if (t.pattern)
+          return std::regex_search(name, *t.pattern);
+        return std::find(t.values.begin(), t.values.end(), name) != t.values.end();
+      }
+      }
+    }
+
+  private:
+    std::vector<struct term> m_terms;
+    std::optional<struct bitwarden::symmetric_key> m_key;
+  };
+}
@@ -0,0 +1,40 @@
+#include <string>
+#include <vector>
+#include "openssl-aes.hpp"
+#include "openssl-baseline.hpp"
+#include "bench.hpp"
+
+// per-entry encryption cost: first versions, cipher built for every call, cloned context and batches
+int main()
+{
+  const std::string& iv_b64 = base64::encode(std::string(16, '\x5a'));
+  const std::string password = "correct horse battery staple";
+  const std::vector<std::string> entries(1000, std::string(aes::get_max_size(aes::mode::cbc, 715), 'x'));
+
+  std::size_t next = 0;
+  bench::report("per entry: first versions (bio base64)", bench::measure(entries.size(), [&]() {
+    bench::keep(baseline::encrypt_256_cbc(entries[next++ % entries.size()], iv_b64, password));
+    }));
+  bench::report("per entry: encrypt_256_cbc (cipher per call)", bench::measure(entries.size(), [&]() {
+    bench::keep(aes::encrypt_256_cbc(entries[next++ % entries.size()], iv_b64, password));
+    }));
+  const aes::cipher c(iv_b64, password);
+  aes::cipher clone = c.clone();
+  bench::report("per entry: cloned cipher context", bench::measure(entries.size(), [&]() {
+    bench::keep(clone.encrypt(entries[next++ % entries.size()]));
+    }));
+  for (const std::size_t batch_size : { 4, 8, 64 })
+  {
+    std::vector<std::string> batch(entries.begin(), entries.begin() + batch_size);
+    const std::vector<std::size_t> indexes(batch_size, 0);
+    bench::report(fmt::format("per entry: cloned cipher context, batch of {}", batch_size), bench::measure(entries.size() / batch_size, [&]() {
+      bench::keep(aes::encrypt_batch(clone, batch, indexes));
+      }) / batch_size);
+  }
+  aes::cipher gcm(iv_b64, aes::hash_sha256(password), aes::mode::gcm);
+  bench::report("per entry: cloned cipher context (gcm)", bench::measure(entries.size(), [&]() {
+    const std::size_t index = next++;
+    bench::keep(gcm.encrypt(entries[index % entries.size()], index));
+    }));
+  return 0;
+}
@@ -0,0 +1,48 @@
+#include <string>
+#include <vector>
+#include <openssl/evp.h>
+#include "openssl-base64.hpp"
+#include "openssl-baseline.hpp"
+#include "bench.hpp"
+
+// base64 of an encrypted entry and of the IV: vectorized codec, scalar code, EVP_EncodeBlock and bio chain
+int main()
+{
+  for (const std::size_t size : { 16, 528, 4096 })
+  {
+    const std::string data(size, 'c');
+    const std::string& b64 = base64::encode(data);
+    std::string str(base64::encoded_size(size), '\0');
+    std::vector<unsigned char> buf(base64::decoded_size(b64.size()) + 3);
+    std::size_t len = 0;
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data.data());
+    const std::size_t iterations = 200000 / (1 + size / 512);
+
+    bench::report(fmt::format("{} bytes: encode (caller buffer)", size), bench::measure(iterations, [&]() {
+      bench::keep(base64::encode(src, size, str.data()));
+      }));
+    bench::report(fmt::format("{} bytes: encode scalar (caller buffer)", size), bench::measure(iterations, [&]() {
+      base64::details::encode_scalar(src, size, str.data());
+      bench::keep(str);
+      }));
+    bench::report(fmt::format("{} bytes: encode (std::string)", size), bench::measure(iterations, [&]() {
+      bench::keep(base64::encode(data));
+      }));
+    bench::report(fmt::format("{} bytes: EVP_EncodeBlock", size), bench::measure(iterations, [&]() {
+      bench::keep(EVP_EncodeBlock(reinterpret_cast<unsigned char*>(str.data()), src, static_cast<int>(size)));
+      }));
+    bench::report(fmt::format("{} bytes: bio chain encode", size), bench::measure(iterations / 10, [&]() {
+      bench::keep(baseline::bio_encode(data));
+      }));
+    bench::report(fmt::format("{} bytes: decode (caller buffer)", size), bench::measure(iterations, [&]() {
+      bench::keep(base64::decode(b64.data(), b64.size(), buf.data(), len));
+      }));
+    bench::report(fmt::format("{} bytes: EVP_DecodeBlock", size), bench::measure(iterations, [&]() {
+      bench::keep(EVP_DecodeBlock(buf.data(), reinterpret_cast<const unsigned char*>(b64.data()), static_cast<int>(b64.size())));
+      }));
+    bench::report(fmt::format("{} bytes: bio chain decode", size), bench::measure(iterations / 10, [&]() {
+      bench::keep(baseline::bio_decode(b64));
+      }));
+  }
+  return 0;
+}
@@ -0,0 +1,37 @@
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <nlohmann/json.hpp>
+#include "bitwarden-reader.hpp"
+#include "payload.hpp"
+#include "vault-generator.hpp"
+#include "bench.hpp"
+
+// compare the json parsers on synthetic exports from 1 MiB to 1 GiB (or the size in MiB given as argument)
+int main(int argc, char** argv)
+{
+  const std::size_t max_mib = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1024;
+  std::vector<std::pair<std::string, bitwarden::backend>> parsers = { { "nlohmann", bitwarden::backend::nlohmann } };
+#ifdef BW2QR_WITH_SIMDJSON
+  parsers.emplace_back("simdjson", bitwarden::backend::simdjson);
+#endif
+
+  for (std::size_t mib = 1; mib <= max_mib; mib *= 4)
+  {
+    // items with notes like a real vault: most of the bytes aren't read
+    const std::string& data = vault::make_export(0, 42, mib * 1024 * 1024, 512);
+    for (const auto& [name, parser] : parsers)
+    {
+      std::size_t nb_entries = 0;
+      payload::writer writer;
+      const double seconds = bench::measure(1, [&]() {
+        nb_entries = 0;
+        bitwarden::parse(data, data.size(), parser,
+          [](const struct bitwarden::item& item) { return (item.type == 1) && item.favorite; },
+          [&](struct bitwarden::item&& item) { bench::keep(writer.write(item)); ++nb_entries; });
+        }, mib >= 256 ? 1 : 3);
+      bench::report(fmt::format("{} MiB {} ({} entries, {:.0f} MiB/s)", mib, name, nb_entries, mib / seconds), seconds, "ms", 1e3);
+    }
+  }
+  return 0;
+}
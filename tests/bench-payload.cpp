@@ -0,0 +1,41 @@
+#include <string>
+#include <vector>
+#include <random>
+#include "bitwarden-reader.hpp"
+#include "payload.hpp"
+#include "payload-baseline.hpp"
+#include "vault-generator.hpp"
+#include "bench.hpp"
+
+// compare the payload writer to the json dump + regex of the first versions
+int main()
+{
+  std::mt19937 rng(7);
+  std::vector<struct bitwarden::item> items(1000);
+  for (auto& item : items)
+  {
+    item.username = vault::details::random_string(rng, 24);
+    item.password = vault::details::random_string(rng, 32);
+    item.totp = vault::details::random_string(rng, 16);
+    for (std::size_t i = rng() % 4; i > 0; --i)
+      item.fields.push_back({ fmt::format("field {}", i), vault::details::random_string(rng, 24) });
+  }
+
+  std::size_t next = 0;
+  const double dump_regex = bench::measure(items.size(), [&]() {
+    bench::keep(baseline::write_payload(items[next++ % items.size()]));
+    });
+  payload::writer writer;
+  for (const auto& [name, format] : { std::make_pair("json", payload::format::json),
+                                      std::make_pair("compact", payload::format::compact),
+                                      std::make_pair("cbor", payload::format::cbor),
+                                      std::make_pair("msgpack", payload::format::msgpack) })
+  {
+    const double seconds = bench::measure(items.size(), [&]() {
+      bench::keep(writer.write(items[next++ % items.size()], format));
+      });
+    bench::report(fmt::format("payload writer: {}", name), seconds);
+  }
+  bench::report("dump + regex baseline: json", dump_regex);
+  return 0;
+}
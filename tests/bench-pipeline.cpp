@@ -0,0 +1,99 @@
+#include <map>
+#include <mutex>
+#include <queue>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <openssl/sha.h>
+#include "bench.hpp"
+
+// simulated work of an entry - a few hashes so that the threads contend on the distribution
+std::string process(const std::size_t index, const std::size_t rounds)
+{
+  unsigned char digest[SHA256_DIGEST_LENGTH] = { 0 };
+  std::memcpy(digest, &index, sizeof(index));
+  for (std::size_t r = 0; r < rounds; ++r)
+    SHA256(digest, sizeof(digest), digest);
+  return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+// first versions: a queue and a map of results, the failures and the progress behind one mutex
+void run_mutex(const std::size_t nb_entries, const std::size_t nb_threads, const std::size_t rounds)
+{
+  std::mutex mutex;
+  std::queue<std::size_t> entries;
+  for (std::size_t i = 0; i < nb_entries; ++i)
+    entries.push(i);
+  std::map<std::string, std::string> results;
+  std::string failures;
+  std::size_t progress = 0;
+  std::vector<std::thread> threads(nb_threads);
+  for (auto& t : threads)
+    t = std::thread([&]() {
+      while (true)
+      {
+        std::size_t index = 0;
+        {
+          std::lock_guard<std::mutex> lck(mutex);
+          if (entries.empty())
+            return;
+          index = entries.front();
+          entries.pop();
+        }
+        const std::string& png = process(index, rounds);
+        {
+          std::lock_guard<std::mutex> lck(mutex);
+          results[std::to_string(index)] = png;
+        }
+        {
+          std::lock_guard<std::mutex> lck(mutex);
+          if (png.empty())
+            failures += "\n";
+          ++progress;
+        }
+      }
+      });
+  for (auto& t : threads)
+    t.join();
+  bench::keep(results);
+}
+
+// atomic index over the entries and one pre-sized result slot per entry
+void run_atomic(const std::size_t nb_entries, const std::size_t nb_threads, const std::size_t rounds)
+{
+  std::atomic<std::size_t> next(0);
+  std::atomic<std::size_t> progress(0);
+  std::vector<std::string> results(nb_entries);
+  std::vector<std::thread> threads(nb_threads);
+  for (auto& t : threads)
+    t = std::thread([&]() {
+      for (std::size_t index = next++; index < nb_entries; index = next++)
+      {
+        results[index] = process(index, rounds);
+        ++progress;
+      }
+      });
+  for (auto& t : threads)
+    t.join();
+  bench::keep(results);
+}
+
+// contention of the work distribution from 1 to 128 threads (or the maximum given as argument)
+int main(int argc, char** argv)
+{
+  const std::size_t max_threads = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 128;
+  const std::size_t nb_entries = 100000;
+  for (const std::size_t rounds : { 1, 16 })
+    for (std::size_t nb_threads = 1; nb_threads <= max_threads; nb_threads *= 2)
+    {
+      const double mutex = bench::measure(1, [&]() { run_mutex(nb_entries, nb_threads, rounds); }, 3);
+      const double atomic = bench::measure(1, [&]() { run_atomic(nb_entries, nb_threads, rounds); }, 3);
+      bench::report(fmt::format("{} threads, {} hashes/entry: mutex", nb_threads, rounds), mutex, "ms", 1e3);
+      bench::report(fmt::format("{} threads, {} hashes/entry: atomic (x{:.1f})", nb_threads, rounds, mutex / atomic), atomic, "ms", 1e3);
+    }
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <set>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <openssl/sha.h>
+#include "schedule.hpp"
+#include "bench.hpp"
+
+// simulated entry: serial steps (qrcodegen, zxing) and an inner loop split between magick threads
+//  like the openmp team of graphicsmagick, the inner threads are started for every loop
+void process(const std::size_t index, const std::size_t magick_threads)
+{
+  auto hash = [&](const std::size_t rounds) {
+    unsigned char digest[SHA256_DIGEST_LENGTH] = { 0 };
+    std::memcpy(digest, &index, sizeof(index));
+    for (std::size_t r = 0; r < rounds; ++r)
+      SHA256(digest, sizeof(digest), digest);
+    bench::keep(digest);
+  };
+  hash(2000);
+  for (std::size_t loop = 0; loop < 4; ++loop)
+  {
+    std::vector<std::thread> team(magick_threads - 1);
+    for (auto& t : team)
+      t = std::thread(hash, 4000 / magick_threads);
+    hash(4000 / magick_threads);
+    for (auto& t : team)
+      t.join();
+  }
+}
+
+// generate the entries with a split of the cores between the entries and the magick threads
+void run(const std::size_t nb_entries, const struct schedule::thread_budget& budget)
+{
+  std::atomic<std::size_t> next(0);
+  std::vector<std::thread> threads(budget.jobs);
+  for (auto& t : threads)
+    t = std::thread([&]() {
+      for (std::size_t index = next++; index < nb_entries; index = next++)
+        process(index, budget.magick_threads);
+      });
+  for (auto& t : threads)
+    t.join();
+}
+
+// sweep the split of the cores (or the number given as argument) for a few vault sizes
+//  from the exact split to twice as many threads as cores
+int main(int argc, char** argv)
+{
+  const std::size_t nb_cores = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+  for (const std::size_t nb_entries : std::set<std::size_t>{ 2, nb_cores, 8 * nb_cores })
+  {
+    const auto automatic = schedule::get_thread_budget(nb_entries, 0, 0, false, nb_cores);
+    std::set<std::pair<std::size_t, std::size_t>> splits = { { automatic.jobs, automatic.magick_threads } };
+    for (std::size_t magick_threads = 1; magick_threads <= nb_cores; magick_threads *= 2)
+      for (const std::size_t oversubscription : { 1, 2 })
+        splits.insert({ std::clamp<std::size_t>(oversubscription * nb_cores / magick_threads, 1, nb_entries), magick_threads });
+    for (const auto& [jobs, magick_threads] : splits)
+    {
+      const double seconds = bench::measure(1, [&]() { run(nb_entries, { jobs, magick_threads }); }, 3);
+      const bool is_auto = (jobs == automatic.jobs) && (magick_threads == automatic.magick_threads);
+      bench::report(fmt::format("{} entries: {} jobs x {} magick threads{}", nb_entries, jobs, magick_threads, is_auto ? " (auto)" : ""), seconds, "ms", 1e3);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace bench
+{
+  // keep the compiler from optimizing a result away
+  //  the address escapes into an empty assembly block which may read any memory: the value and
+  //  what it points to have to be computed - msvc has no inline assembly on x64: the bytes of the
+  //  value are read through a volatile pointer instead
+  template<typename T>
+  inline void keep(const T& value)
+  {
+#if defined(_MSC_VER) && !defined(__clang__)
+    const volatile char* bytes = reinterpret_cast<const volatile char*>(&value);
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+      static_cast<void>(bytes[i]);
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+  }
+
+  // measure the best time of a function called iterations times over a few runs - in seconds per call
+  template<typename F>
+  inline double measure(const std::size_t iterations, F&& fct, const std::size_t runs = 5)
+  {
+    double best = 0.0;
+    for (std::size_t r = 0; r < runs; ++r)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < iterations; ++i)
+        fct();
+      const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+      best = r ? std::min(best, elapsed) : elapsed;
+    }
+    return best;
+  }
+
+  // print a result line of a benchmark
+  inline void report(const std::string& name, const double seconds, const std::string& unit = "us", const double scale = 1e6)
+  {
+    fmt::print("{:<60}{:>12.3f} {}\n", name + ": ", seconds * scale, unit);
+  }
+}
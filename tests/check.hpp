@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <exception>
+#include <functional>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace check
+{
+  // test case: name and function throwing on failure
+  using test_case = std::pair<std::string, std::function<void()>>;
+
+  // report a failed check
+  [[noreturn]] inline void fail(const char* expr, const char* file, const int line)
+  {
+    throw std::runtime_error(fmt::format("{}:{}: check failed: {}", file, line, expr));
+  }
+
+  // run all the test cases - returns the exit code of the test program
+  inline int run(const std::vector<test_case>& cases)
+  {
+    int failures = 0;
+    for (const auto& [name, fct] : cases)
+    {
+      try
+      {
+        fct();
+        fmt::print("{:<60}[OK]\n", name + ": ");
+      }
+      catch (const std::exception& ex)
+      {
+        fmt::print("{:<60}[KO]\n  {}\n", name + ": ", ex.what());
+        ++failures;
+      }
+    }
+    return failures ? 1 : 0;
+  }
+}
+
+// check a condition of a test case
+#define CHECK(expr) ((expr) ? static_cast<void>(0) : check::fail(#expr, __FILE__, __LINE__))
+
+// check that a statement throws
+#define CHECK_THROWS(stmt) \
+  do { bool thrown = false; try { stmt; } catch (...) { thrown = true; } if (!thrown) check::fail(#stmt " throws", __FILE__, __LINE__); } while (false)
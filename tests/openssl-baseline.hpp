@@ -0,0 +1,121 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <openssl/evp.h>
+#include <openssl/bio.h>
+#include <openssl/aes.h>
+#include <openssl/sha.h>
+#include <openssl/buffer.h>
+
+// reference implementations with openssl only - the behavior of the first versions
+namespace baseline
+{
+  // encode in base64 with the BIO chain of the first versions
+  inline std::string bio_encode(const std::string& data)
+  {
+    BIO* b64 = BIO_new(BIO_f_base64());
+    BIO* bio = BIO_new(BIO_s_mem());
+    bio = BIO_push(b64, bio);
+    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
+    BIO_write(bio, data.data(), static_cast<int>(data.size()));
+    BIO_flush(bio);
+    BUF_MEM* buf = nullptr;
+    BIO_get_mem_ptr(bio, &buf);
+    std::string base64_str(buf->data, buf->length);
+    BIO_free_all(bio);
+    return base64_str;
+  }
+
+  // decode base64 with the BIO chain of the first versions
+  inline std::vector<unsigned char> bio_decode(const std::string& data)
+  {
+    BIO* b64 = BIO_new(BIO_f_base64());
+    BIO* bio = BIO_new_mem_buf(data.c_str(), static_cast<int>(data.size()));
+    bio = BIO_push(b64, bio);
+    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
+    char buffer[1024];
+    std::vector<unsigned char> buf;
+    for (int bytes = BIO_read(bio, buffer, sizeof(buffer)); bytes > 0; bytes = BIO_read(bio, buffer, sizeof(buffer)))
+      buf.insert(buf.end(), buffer, buffer + bytes);
+    BIO_free_all(bio);
+    return buf;
+  }
+
+  // encode in base64 with EVP_EncodeBlock
+  inline std::string evp_encode(const std::string& data)
+  {
+    std::string b64(4 * ((data.size() + 2) / 3) + 1, '\0');
+    const int len = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(b64.data()), reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size()));
+    b64.resize(len);
+    return b64;
+  }
+
+  // decode base64 with EVP_DecodeBlock - false if invalid
+  //  EVP_DecodeBlock keeps the bytes of the padding: they are removed from its output
+  inline bool evp_decode(const std::string& b64, std::vector<unsigned char>& data)
+  {
+    data.assign(3 * (b64.size() / 4) + 3, 0);
+    const int len = EVP_DecodeBlock(data.data(), reinterpret_cast<const unsigned char*>(b64.data()), static_cast<int>(b64.size()));
+    if ((len < 0) || (b64.size() % 4))
+      return false;
+    std::size_t size = static_cast<std::size_t>(len);
+    for (std::size_t i = b64.size(); (i > 0) && (b64[i - 1] == '=') && (size > 0); --i)
+      --size;
+    data.resize(size);
+    return true;
+  }
+
+  // encrypt with aes-256-cbc and a new context - raw cipher
+  inline std::string encrypt_cbc(const std::string& data, const unsigned char* key, const unsigned char* iv)
+  {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    std::string cipher(data.size() + AES_BLOCK_SIZE, '\0');
+    int len = 0;
+    int final_len = 0;
+    if (!ctx ||
+        (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key, iv) != 1) ||
+        (EVP_EncryptUpdate(ctx, reinterpret_cast<unsigned char*>(cipher.data()), &len, reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size())) != 1) ||
+        (EVP_EncryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(cipher.data()) + len, &final_len) != 1))
+    {
+      EVP_CIPHER_CTX_free(ctx);
+      throw std::runtime_error("can't encrypt the reference aes-256-cbc");
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    cipher.resize(len + final_len);
+    return cipher;
+  }
+
+  // decrypt and authenticate aes-256-gcm - false if the tag doesn't match
+  inline bool decrypt_gcm(const std::string& cipher, const unsigned char* key, const std::size_t nonce_size, const std::size_t tag_size, std::string& data)
+  {
+    if (cipher.size() < nonce_size + tag_size)
+      return false;
+    const unsigned char* nonce = reinterpret_cast<const unsigned char*>(cipher.data());
+    const std::size_t size = cipher.size() - nonce_size - tag_size;
+    std::string tag = cipher.substr(nonce_size + size);
+    data.assign(size, '\0');
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int len = 0;
+    const bool ok = ctx &&
+      (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1) &&
+      (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(nonce_size), nullptr) == 1) &&
+      (EVP_DecryptInit_ex(ctx, nullptr, nullptr, key, nonce) == 1) &&
+      (EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char*>(data.data()), &len, nonce + nonce_size, static_cast<int>(size)) == 1) &&
+      (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(tag_size), tag.data()) == 1) &&
+      (EVP_DecryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(data.data()) + len, &len) == 1);
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+  }
+
+  // encrypt like the first versions: key hashed, IV decoded and a new context for every entry
+  inline std::string encrypt_256_cbc(const std::string& data, const std::string& iv_b64, const std::string& password)
+  {
+    unsigned char key[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(password.data()), password.size(), key);
+    const std::vector<unsigned char>& iv = bio_decode(iv_b64);
+    if (iv.size() != AES_BLOCK_SIZE)
+      throw std::runtime_error("invalid iv size");
+    return bio_encode(encrypt_cbc(data, key, iv.data()));
+  }
+}
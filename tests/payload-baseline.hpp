@@ -0,0 +1,28 @@
+#pragma once
+#include <regex>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "bitwarden-reader.hpp"
+
+namespace baseline
+{
+  using json = nlohmann::ordered_json;
+
+  // payload of an item as built by the first versions: json dump compacted with a regex
+  inline std::string write_payload(const struct bitwarden::item& item)
+  {
+    json entry;
+    entry["login"] = json::object();
+    entry["login"]["username"] = item.username;
+    entry["login"]["password"] = item.password;
+    entry["login"]["totp"] = item.totp;
+    entry["fields"] = json::array();
+    for (const auto& field : item.fields)
+    {
+      json obj;
+      obj[field.name] = field.value;
+      entry["fields"].push_back(obj);
+    }
+    return std::regex_replace(entry.dump(2), std::regex(R"([ ]{4}[{]\s[ ]{6}([^\n]+)\n[ ]{4}[}])"), "    { $1 }");
+  }
+}
@@ -0,0 +1,161 @@
+#include <string>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <openssl/sha.h>
+#include "openssl-aes.hpp"
+#include "openssl-baseline.hpp"
+#include "check.hpp"
+
+// IV, password and key of the tests
+const std::string g_iv(16, '\x5a');
+const std::string g_iv_b64 = baseline::evp_encode(g_iv);
+const std::string g_password = "correct horse battery staple";
+
+// SHA-256 key of the password
+std::vector<unsigned char> get_key()
+{
+  std::vector<unsigned char> key(SHA256_DIGEST_LENGTH);
+  SHA256(reinterpret_cast<const unsigned char*>(g_password.data()), g_password.size(), key.data());
+  return key;
+}
+
+// data of all the sizes around the aes blocks
+std::vector<std::string> get_data()
+{
+  std::vector<std::string> data;
+  for (std::size_t size = 0; size <= 600; size += (size < 64) ? 1 : 37)
+  {
+    std::string str(size, '\0');
+    for (std::size_t i = 0; i < size; ++i)
+      str[i] = static_cast<char>((i * 131 + size) & 0xff);
+    data.push_back(str);
+  }
+  return data;
+}
+
+int main()
+{
+  return check::run({
+    { "cipher matches the first versions", []() {
+      aes::cipher c(g_iv_b64, g_password);
+      for (const auto& data : get_data())
+      {
+        const std::string& expected = baseline::encrypt_256_cbc(data, g_iv_b64, g_password);
+        CHECK(c.encrypt(data) == expected);
+        CHECK(aes::encrypt_256_cbc(data, g_iv_b64, g_password) == expected);
+      }
+      } },
+    { "cipher with a derived key matches evp", []() {
+      const std::vector<unsigned char> key(32, 0x11);
+      aes::cipher c(g_iv_b64, key, aes::mode::cbc);
+      for (const auto& data : get_data())
+        CHECK(c.encrypt(data) == baseline::evp_encode(baseline::encrypt_cbc(data, key.data(), reinterpret_cast<const unsigned char*>(g_iv.data()))));
+      } },
+    { "cloned contexts stay byte-identical", []() {
+      aes::cipher c(g_iv_b64, g_password);
+      const std::vector<std::string>& data = get_data();
+      std::vector<std::string> expected;
+      for (const auto& d : data)
+        expected.push_back(c.encrypt(d));
+
+      // clones of a used context, used in any order
+      aes::cipher first = c.clone();
+      aes::cipher second = first.clone();
+      for (std::size_t i = data.size(); i > 0; --i)
+      {
+        CHECK(first.encrypt(data[i - 1]) == expected[i - 1]);
+        CHECK(second.encrypt(data[(i * 7) % data.size()]) == expected[(i * 7) % data.size()]);
+      }
+      aes::cipher moved(std::move(first));
+      CHECK(moved.encrypt(data.back()) == expected.back());
+      } },
+    { "cloned contexts in concurrent threads", []() {
+      const aes::cipher c(g_iv_b64, g_password);
+      const std::vector<std::string>& data = get_data();
+      std::vector<std::vector<std::string>> results(8);
+      std::vector<std::thread> threads;
+      for (auto& result : results)
+        threads.emplace_back([&, clone = std::make_shared<aes::cipher>(c.clone())]() {
+          for (std::size_t round = 0; round < 20; ++round)
+          {
+            result.clear();
+            for (const auto& d : data)
+              result.push_back(clone->encrypt(d));
+          }
+          });
+      for (auto& t : threads)
+        t.join();
+      for (const auto& result : results)
+        for (std::size_t i = 0; i < data.size(); ++i)
+          CHECK(result[i] == baseline::encrypt_256_cbc(data[i], g_iv_b64, g_password));
+      } },
+    { "gcm clones encrypt and authenticate", []() {
+      const std::vector<unsigned char>& key = get_key();
+      aes::cipher c(g_iv_b64, key, aes::mode::gcm);
+      aes::cipher clone = c.clone();
+      std::size_t index = 0;
+      for (const auto& data : get_data())
+      {
+        const std::string& b64 = c.encrypt(data, index);
+        CHECK(clone.encrypt(data, index) == b64);
+        std::vector<unsigned char> cipher;
+        CHECK(baseline::evp_decode(b64, cipher));
+        std::string plain;
+        CHECK(baseline::decrypt_gcm(std::string(cipher.begin(), cipher.end()), key.data(), aes::gcm_nonce_size, aes::gcm_tag_size, plain));
+        CHECK(plain == data);
+        CHECK(cipher[aes::gcm_nonce_size - 1] == static_cast<unsigned char>(index & 0xff));
+        cipher.back() ^= 1;
+        CHECK(!baseline::decrypt_gcm(std::string(cipher.begin(), cipher.end()), key.data(), aes::gcm_nonce_size, aes::gcm_tag_size, plain));
+        ++index;
+      }
+      } },
+    { "batch encryption matches evp cbc", []() {
+      const std::vector<unsigned char>& key = get_key();
+      aes::cipher c(g_iv_b64, g_password);
+      const std::vector<std::string>& sizes = get_data();
+      for (std::size_t nb_entries = 0; nb_entries <= 20; ++nb_entries)
+      {
+        // entries of different sizes: the lanes are grouped by decreasing size
+        std::vector<std::string> data;
+        for (std::size_t i = 0; i < nb_entries; ++i)
+          data.push_back(sizes[(i * 17 + nb_entries) % sizes.size()]);
+        const std::vector<std::string>& ciphers = aes::encrypt_batch(c, data, std::vector<std::size_t>(data.size(), 0));
+        CHECK(ciphers.size() == data.size());
+        for (std::size_t i = 0; i < data.size(); ++i)
+          CHECK(ciphers[i] == baseline::evp_encode(baseline::encrypt_cbc(data[i], key.data(), reinterpret_cast<const unsigned char*>(g_iv.data()))));
+      }
+
+      // the context is still usable for single entries
+      CHECK(c.encrypt(sizes.back()) == baseline::encrypt_256_cbc(sizes.back(), g_iv_b64, g_password));
+      } },
+    { "batch encryption of a clone in concurrent threads", []() {
+      const aes::cipher c(g_iv_b64, g_password);
+      const std::vector<std::string>& data = get_data();
+      std::vector<std::vector<std::string>> results(4);
+      std::vector<std::thread> threads;
+      for (auto& result : results)
+        threads.emplace_back([&, clone = std::make_shared<aes::cipher>(c.clone())]() {
+          result = aes::encrypt_batch(*clone, data, std::vector<std::size_t>(data.size(), 0));
+          });
+      for (auto& t : threads)
+        t.join();
+      for (const auto& result : results)
+        for (std::size_t i = 0; i < data.size(); ++i)
+          CHECK(result[i] == baseline::encrypt_256_cbc(data[i], g_iv_b64, g_password));
+      } },
+    { "gcm batch encryption uses the entries indexes", []() {
+      aes::cipher c(g_iv_b64, get_key(), aes::mode::gcm);
+      const std::vector<std::string> data = { "first", "second", std::string(300, 'x') };
+      const std::vector<std::size_t> indexes = { 7, 3, 1000 };
+      const std::vector<std::string>& ciphers = aes::encrypt_batch(c, data, indexes);
+      for (std::size_t i = 0; i < data.size(); ++i)
+        CHECK(ciphers[i] == c.encrypt(data[i], indexes[i]));
+      } },
+    { "invalid key or iv is rejected", []() {
+      CHECK_THROWS(aes::cipher(baseline::evp_encode(std::string(8, 'x')), g_password));
+      CHECK_THROWS(aes::cipher(g_iv_b64, std::vector<unsigned char>(16, 0), aes::mode::cbc));
+      CHECK_THROWS(aes::cipher(g_iv_b64, get_key(), aes::mode::gcm).encrypt("x", std::size_t(1) << 32));
+      } },
+    });
+}
@@ -0,0 +1,140 @@
+#include <string>
+#include <random>
+#include <vector>
+#include <functional>
+#include "openssl-base64.hpp"
+#include "openssl-baseline.hpp"
+#include "check.hpp"
+
+// code path of the codec: scalar, ssse3 or avx2 for the bulk and scalar for the tail
+struct codec
+{
+  std::string name;
+  std::function<std::size_t(const unsigned char*, std::size_t, char*)> encode_bulk;
+  std::function<std::size_t(const char*, std::size_t, unsigned char*)> decode_bulk;
+};
+
+// code paths supported by this processor - the public api dispatches to the fastest one
+std::vector<struct codec> get_codecs()
+{
+  std::vector<struct codec> codecs = { { "scalar", [](const unsigned char*, std::size_t, char*) { return std::size_t(0); },
+                                                   [](const char*, std::size_t, unsigned char*) { return std::size_t(0); } } };
+#ifdef BW2QR_WITH_X64_SIMD
+  if (cpu::get_features().ssse3)
+    codecs.push_back({ "ssse3", base64::details::encode_ssse3, base64::details::decode_ssse3 });
+  if (cpu::get_features().avx2)
+    codecs.push_back({ "avx2", base64::details::encode_avx2, base64::details::decode_avx2 });
+#endif
+  return codecs;
+}
+
+// encode with a code path
+std::string encode(const struct codec& c, const std::string& data)
+{
+  std::string b64(base64::encoded_size(data.size()), '\0');
+  const unsigned char* src = reinterpret_cast<const unsigned char*>(data.data());
+  const std::size_t i = c.encode_bulk(src, data.size(), b64.data());
+  base64::details::encode_scalar(src + i, data.size() - i, b64.data() + i / 3 * 4);
+  return b64;
+}
+
+// decode with a code path - false if invalid
+bool decode(const struct codec& c, const std::string& b64, std::string& data)
+{
+  std::size_t size = b64.size();
+  if ((size % 4 == 0) && (size > 0) && (b64[size - 1] == '='))
+    size -= (b64[size - 2] == '=') ? 2 : 1;
+  std::vector<unsigned char> buf(base64::decoded_size(b64.size()));
+  const std::size_t i = c.decode_bulk(b64.data(), size, buf.data());
+  const std::ptrdiff_t len = base64::details::decode_scalar(b64.data() + i, size - i, buf.data() + i / 4 * 3);
+  if (len < 0)
+    return false;
+  data.assign(buf.begin(), buf.begin() + i / 4 * 3 + len);
+  return true;
+}
+
+// random bytes of every size up to 512
+std::vector<std::string> get_data()
+{
+  std::mt19937 rng(25);
+  std::vector<std::string> data;
+  for (std::size_t size = 0; size <= 512; ++size)
+    for (std::size_t rep = 0; rep < 3; ++rep)
+    {
+      std::string str(size, '\0');
+      for (auto& c : str)
+        c = static_cast<char>(rng());
+      data.push_back(str);
+    }
+  return data;
+}
+
+int main()
+{
+  return check::run({
+    { "encode matches EVP_EncodeBlock", []() {
+      for (const auto& data : get_data())
+      {
+        const std::string& expected = baseline::evp_encode(data);
+        CHECK(base64::encode(data) == expected);
+        for (const auto& c : get_codecs())
+          CHECK(encode(c, data) == expected);
+      }
+      } },
+    { "encode matches the bio chain", []() {
+      for (const auto& data : get_data())
+        CHECK(base64::encode(data) == baseline::bio_encode(data));
+      } },
+    { "decode matches EVP_DecodeBlock", []() {
+      for (const auto& data : get_data())
+      {
+        const std::string& b64 = baseline::evp_encode(data);
+        std::vector<unsigned char> expected;
+        CHECK(baseline::evp_decode(b64, expected));
+        CHECK(base64::decode(b64) == expected);
+        for (const auto& c : get_codecs())
+        {
+          std::string decoded;
+          CHECK(decode(c, b64, decoded) && (decoded == std::string(expected.begin(), expected.end())));
+        }
+      }
+      } },
+    { "decode into a caller buffer", []() {
+      const std::string& b64 = baseline::evp_encode("any carnal pleasure.");
+      std::vector<unsigned char> buf(base64::decoded_size(b64.size()));
+      std::size_t size = 0;
+      CHECK(base64::decode(b64.data(), b64.size(), buf.data(), size));
+      CHECK((size == 20) && (std::string(buf.begin(), buf.begin() + size) == "any carnal pleasure."));
+      char str[base64::encoded_size(3)];
+      CHECK(base64::encode(reinterpret_cast<const unsigned char*>("abc"), 3, str) == 4);
+      CHECK(std::string(str, 4) == "YWJj");
+      } },
+    { "decode accepts unpadded data", []() {
+      CHECK((base64::decode("YQ") == std::vector<unsigned char>{ 'a' }));
+      CHECK((base64::decode("YWI") == std::vector<unsigned char>{ 'a', 'b' }));
+      CHECK(base64::decode("").empty());
+      } },
+    { "decode rejects invalid data", []() {
+      const std::string& b64 = baseline::evp_encode(std::string(300, 'x'));
+      std::vector<unsigned char> ignored;
+      for (const char invalid : { '*', '=', '\n', ' ', '-', '_', '\0', '\x80', '\xff' })
+        for (std::size_t pos = 0; pos + 1 < b64.size(); ++pos)
+        {
+          // the padding is only valid at the end
+          std::string str(b64);
+          str[pos] = invalid;
+          CHECK(base64::decode(str).empty());
+          for (const auto& c : get_codecs())
+          {
+            std::string decoded;
+            CHECK(!decode(c, str, decoded));
+          }
+          if (invalid == '*')
+            CHECK(!baseline::evp_decode(str, ignored));
+        }
+      const std::vector<std::string> malformed = { "Y", "YWJjZ", "====", "YQ===", "Y===", "=YWJ", "YW=j" };
+      for (const auto& str : malformed)
+        CHECK(base64::decode(str).empty());
+      } },
+    });
+}
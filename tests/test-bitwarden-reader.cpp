@@ -0,0 +1,134 @@
+#include <regex>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "bitwarden-reader.hpp"
+#include "payload.hpp"
+#include "vault-generator.hpp"
+#include "check.hpp"
+
+using json = nlohmann::ordered_json;
+
+// title, data and url of a QR Code entry
+using entry = std::tuple<std::string, std::string, std::string>;
+
+// read the favorite logins with the DOM parser and the dump + regex layout of the first versions
+std::vector<entry> read_baseline(const std::string& data)
+{
+  auto get_field = [](const json& obj, const std::string& field_name) -> const std::string {
+    if (!obj.contains(field_name) ||
+        !obj[field_name].is_string() ||
+        obj[field_name].empty())
+      return {};
+    return obj[field_name].get<std::string>();
+  };
+
+  std::vector<entry> entries;
+  const auto& db = json::parse(data);
+  if (!db.contains("items") || !db["items"].is_array())
+    throw std::runtime_error("invalid json file format");
+  for (const auto& item : db["items"])
+  {
+    if ((!item.contains("name") || !item["name"].is_string()) ||
+        (!item.contains("type") || !item["type"].is_number()) ||
+        (!item.contains("favorite") || !item["favorite"].is_boolean()))
+      throw std::runtime_error("invalid json file format");
+    if (item["type"].get<int>() != 1 || !item["favorite"].get<bool>())
+      continue;
+    if (!item.contains("login") || !item["login"].is_object())
+      throw std::runtime_error("invalid json file format");
+
+    json entry;
+    entry["login"] = json::object();
+    entry["login"]["username"] = get_field(item["login"], "username");
+    entry["login"]["password"] = get_field(item["login"], "password");
+    entry["login"]["totp"] = get_field(item["login"], "totp");
+    entry["fields"] = json::array();
+    if (item.contains("fields"))
+    {
+      for (const auto& field : item["fields"])
+      {
+        if (!get_field(field, "name").empty())
+        {
+          json obj;
+          obj[get_field(field, "name")] = get_field(field, "value");
+          entry["fields"].push_back(obj);
+        }
+      }
+    }
+    const std::string& title = get_field(item, "name");
+    const std::string& qr_data = std::regex_replace(entry.dump(2), std::regex(R"([ ]{4}[{]\s[ ]{6}([^\n]+)\n[ ]{4}[}])"), "    { $1 }");
+    const std::string& url = (item["login"].contains("uris") && item["login"]["uris"].size()) ?
+      get_field(item["login"]["uris"].at(0), "uri") : "";
+    entries.emplace_back(title, qr_data, url);
+  }
+  return entries;
+}
+
+// read the favorite logins with a streaming reader and the payload writer
+std::vector<entry> read_streamed(const std::string& data, const bitwarden::backend parser)
+{
+  std::vector<entry> entries;
+  payload::writer writer;
+  bitwarden::parse(data, data.size(), parser,
+    [](const struct bitwarden::item& item) { return (item.type == 1) && item.favorite; },
+    [&](struct bitwarden::item&& item) { entries.emplace_back(item.name, writer.write(item), item.uri); });
+  return entries;
+}
+
+// json parsers of this build
+std::vector<bitwarden::backend> get_backends()
+{
+  std::vector<bitwarden::backend> backends = { bitwarden::backend::nlohmann };
+#ifdef BW2QR_WITH_SIMDJSON
+  backends.push_back(bitwarden::backend::simdjson);
+#endif
+  return backends;
+}
+
+int main()
+{
+  return check::run({
+    { "streamed readers match the dom baseline", []() {
+      for (std::uint32_t seed = 1; seed <= 20; ++seed)
+      {
+        const std::string& data = vault::make_export(200, seed);
+        const std::vector<entry>& expected = read_baseline(data);
+        CHECK(!expected.empty());
+        for (const auto parser : get_backends())
+          CHECK(read_streamed(data, parser) == expected);
+      }
+      } },
+    { "empty items array", []() {
+      const std::string data = R"({"encrypted":false,"items":[]})";
+      for (const auto parser : get_backends())
+        CHECK(read_streamed(data, parser).empty());
+      } },
+    { "selected login without login object is rejected", []() {
+      const std::string missing = R"({"items":[{"name":"a","type":1,"favorite":true}]})";
+      const std::string null = R"({"items":[{"name":"a","type":1,"favorite":true,"login":null}]})";
+      CHECK_THROWS(read_baseline(missing));
+      for (const auto parser : get_backends())
+      {
+        CHECK_THROWS(read_streamed(missing, parser));
+        CHECK_THROWS(read_streamed(null, parser));
+      }
+      } },
+    { "non-selected item without login object is skipped", []() {
+      const std::string data = R"({"items":[{"name":"a","type":1,"favorite":false},{"name":"n","type":2,"favorite":true}]})";
+      for (const auto parser : get_backends())
+        CHECK(read_streamed(data, parser).empty());
+      } },
+    { "invalid json is rejected", []() {
+      const std::string& data = vault::make_export(10);
+      const std::string truncated = data.substr(0, data.size() / 2);
+      const std::string no_name = R"({"items":[{"type":1,"favorite":true,"login":{}}]})";
+      for (const auto parser : get_backends())
+      {
+        CHECK_THROWS(read_streamed(truncated, parser));
+        CHECK_THROWS(read_streamed(no_name, parser));
+      }
+      } },
+    });
+}
@@ -0,0 +1,129 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include "journal.hpp"
+#include "check.hpp"
+
+namespace
+{
+  const std::filesystem::path g_journal_file = std::filesystem::temp_directory_path() / "bw2qr-test.journal";
+  const std::string g_fingerprint("version\nstylesheet\ncipher:aes-256-cbc\nkdf:pbkdf2-sha256");
+  const std::string g_iv("AAECAwQFBgcICQoLDA0ODw==");
+  const std::string g_kdf("pbkdf2-sha256:i=1000:salt=00112233445566778899aabbccddeeff");
+  const std::vector<unsigned char> g_key(32, 0x42);
+
+  // QR Code image of an entry
+  struct qr::PngImage make_png(const std::size_t i)
+  {
+    return { 100 + i, 200 + i, std::string(64 + i, static_cast<char>('a' + i)) };
+  }
+
+  // journal of a run interrupted after some entries
+  void write_journal(const std::size_t nb_entries, const std::vector<unsigned char>& key = g_key)
+  {
+    journal::journal qr_journal(g_journal_file);
+    qr_journal.open(g_fingerprint, g_iv, g_kdf, key);
+    for (std::size_t i = 0; i < nb_entries; ++i)
+      qr_journal.append(qr_journal.get_key(fmt::format("title{}", i), "data", "url"), make_png(i));
+  }
+
+  // check that a loaded journal holds the first entries
+  void check_entries(journal::journal& qr_journal, const std::size_t nb_entries)
+  {
+    CHECK(qr_journal.size() == nb_entries);
+    for (std::size_t i = 0; i < nb_entries; ++i)
+    {
+      struct qr::PngImage png;
+      CHECK(qr_journal.find(qr_journal.get_key(fmt::format("title{}", i), "data", "url"), png));
+      const struct qr::PngImage& expected = make_png(i);
+      CHECK((png.width == expected.width) && (png.height == expected.height) && (png.data == expected.data));
+    }
+  }
+}
+
+int main()
+{
+  return check::run({
+    { "journal resumes the recorded QR Codes", []() {
+      std::filesystem::remove(g_journal_file);
+      CHECK(!journal::journal(g_journal_file).load(g_fingerprint));
+      write_journal(3);
+      {
+        journal::journal qr_journal(g_journal_file);
+        CHECK(qr_journal.load(g_fingerprint));
+        CHECK((qr_journal.iv() == g_iv) && (qr_journal.kdf() == g_kdf));
+        qr_journal.open(g_fingerprint, "other-iv", "other-kdf", g_key);
+        check_entries(qr_journal, 3);
+        struct qr::PngImage png;
+        CHECK(!qr_journal.find(qr_journal.get_key("title3", "data", "url"), png));
+        qr_journal.append(qr_journal.get_key("title3", "data", "url"), make_png(3));
+      }
+      journal::journal qr_journal(g_journal_file);
+      CHECK(qr_journal.load(g_fingerprint));
+      CHECK(qr_journal.iv() == g_iv);
+      qr_journal.open(g_fingerprint, g_iv, g_kdf, g_key);
+      check_entries(qr_journal, 4);
+      qr_journal.remove();
+      CHECK(!std::filesystem::exists(g_journal_file));
+      } },
+    { "journal drops the truncated record", []() {
+      write_journal(2);
+      const std::uintmax_t size = std::filesystem::file_size(g_journal_file);
+      std::filesystem::resize_file(g_journal_file, size - 5);
+      {
+        journal::journal qr_journal(g_journal_file);
+        CHECK(qr_journal.load(g_fingerprint));
+        qr_journal.open(g_fingerprint, g_iv, g_kdf, g_key);
+        check_entries(qr_journal, 1);
+        qr_journal.append(qr_journal.get_key("title1", "data", "url"), make_png(1));
+      }
+      CHECK(std::filesystem::file_size(g_journal_file) == size);
+      journal::journal qr_journal(g_journal_file);
+      CHECK(qr_journal.load(g_fingerprint));
+      qr_journal.open(g_fingerprint, g_iv, g_kdf, g_key);
+      check_entries(qr_journal, 2);
+      qr_journal.remove();
+      } },
+    { "journal refuses a different password or options", []() {
+      write_journal(1);
+      {
+        journal::journal qr_journal(g_journal_file);
+        CHECK(qr_journal.load(g_fingerprint));
+        CHECK_THROWS(qr_journal.open(g_fingerprint, g_iv, g_kdf, std::vector<unsigned char>(32, 0x43)));
+      }
+      {
+        journal::journal qr_journal(g_journal_file);
+        CHECK(qr_journal.load(g_fingerprint));
+        CHECK_THROWS(qr_journal.open(g_fingerprint, g_iv, g_kdf, {}));
+      }
+      CHECK_THROWS(journal::journal(g_journal_file).load(g_fingerprint + "\nother"));
+
+      // the password check is derived from the key: neither the key nor the password is stored
+      std::ifstream file(g_journal_file, std::ios::binary);
+      const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      file.close();
+      CHECK(data.find(std::string(g_key.begin(), g_key.end())) == std::string::npos);
+      CHECK(data.find(journal::details::to_hex(g_key.data(), g_key.size())) == std::string::npos);
+
+      std::ofstream(g_journal_file, std::ios::binary | std::ios::trunc) << "not a journal";
+      CHECK_THROWS(journal::journal(g_journal_file).load(g_fingerprint));
+      std::filesystem::remove(g_journal_file);
+      } },
+    { "journal keys are keyed by the cipher key", []() {
+      auto get_key = [](const std::vector<unsigned char>& key, const std::string& title, const std::string& data) {
+        journal::journal qr_journal(g_journal_file);
+        qr_journal.open(g_fingerprint, g_iv, g_kdf, key);
+        const std::string& journal_key = qr_journal.get_key(title, data, "url");
+        qr_journal.remove();
+        return journal_key;
+      };
+      CHECK(get_key(g_key, "title", "data") == get_key(g_key, "title", "data"));
+      CHECK(get_key(g_key, "title", "data") != get_key(std::vector<unsigned char>(32, 0x43), "title", "data"));
+      CHECK(get_key(g_key, "ab", "c") != get_key(g_key, "a", "bc"));
+      // without password the key is fixed
+      CHECK(get_key({}, "title", "data") == get_key({}, "title", "data"));
+      CHECK(get_key({}, "title", "data") != get_key(g_key, "title", "data"));
+      } },
+  });
+}
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <openssl/sha.h>
+#include "openssl-kdf.hpp"
+#include "check.hpp"
+
+// convert bytes to hexadecimal
+std::string to_hex(const std::vector<unsigned char>& data)
+{
+  std::string hex;
+  for (const auto& byte : data)
+    hex += fmt::format("{:02x}", byte);
+  return hex;
+}
+
+// convert a string to bytes
+std::vector<unsigned char> to_bytes(const std::string& str)
+{
+  return std::vector<unsigned char>(str.begin(), str.end());
+}
+
+int main()
+{
+  return check::run({
+    { "pbkdf2-sha256 matches the known vectors", []() {
+      CHECK(to_hex(kdf::pbkdf2_sha256("password", to_bytes("salt"), 1, 32)) ==
+            "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b");
+      CHECK(to_hex(kdf::pbkdf2_sha256("password", to_bytes("salt"), 4096, 32)) ==
+            "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+      // RFC 7914 section 11
+      CHECK(to_hex(kdf::pbkdf2_sha256("passwd", to_bytes("salt"), 1, 64)) ==
+            "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+            "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783");
+      CHECK(to_hex(kdf::pbkdf2_sha256("Password", to_bytes("NaCl"), 80000, 64)) ==
+            "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+            "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d");
+      } },
+    { "hkdf-sha256 expand matches the RFC 5869 vector", []() {
+      const std::vector<unsigned char> prk = {
+        0x07, 0x77, 0x09, 0x36, 0x2c, 0x2e, 0x32, 0xdf, 0x0d, 0xdc, 0x3f, 0x0d, 0xc4, 0x7b, 0xba, 0x63,
+        0x90, 0xb6, 0xc7, 0x3b, 0xb5, 0x0f, 0x9c, 0x31, 0x22, 0xec, 0x84, 0x4a, 0xd7, 0xc2, 0xb3, 0xe5 };
+      const std::string info("\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9");
+      CHECK(to_hex(kdf::hkdf_expand_sha256(prk, info, 42)) ==
+            "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865");
+      } },
+    { "derive dispatches on the algorithm", []() {
+      struct kdf::params p = kdf::get_params("pbkdf2-sha256", 4096, 0);
+      p.salt = to_bytes("salt");
+      CHECK(kdf::derive("password", p, 32) == kdf::pbkdf2_sha256("password", p.salt, 4096, 32));
+      const struct kdf::params& sha256 = kdf::get_params("sha256", 0, 0);
+      std::vector<unsigned char> digest(SHA256_DIGEST_LENGTH, 0);
+      SHA256(reinterpret_cast<const unsigned char*>("password"), 8, digest.data());
+      CHECK(kdf::derive("password", sha256, 32) == digest);
+      CHECK_THROWS(kdf::derive("password", sha256, 16));
+      struct kdf::params argon2 = kdf::get_params("argon2id", 1, 64);
+      argon2.salt = to_bytes("saltsaltsaltsalt");
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+      const std::vector<unsigned char>& key = kdf::derive("password", argon2, 32);
+      CHECK((key.size() == 32) && (key == kdf::derive("password", argon2, 32)));
+      argon2.salt = to_bytes("othersaltothersa");
+      CHECK(key != kdf::derive("password", argon2, 32));
+#else
+      CHECK_THROWS(kdf::derive("password", argon2, 32));
+#endif
+      } },
+    { "settings round-trip through their description", []() {
+      struct kdf::params pbkdf2 = kdf::get_params("pbkdf2-sha256", 0, 0);
+      pbkdf2.salt = { 0xdf, 0x24, 0x14, 0x93, 0x27, 0x82, 0x68, 0x39, 0xb0, 0x0c, 0x3f, 0x8f, 0x34, 0xe2, 0x39, 0x8e };
+      CHECK(kdf::to_string(pbkdf2) == "pbkdf2-sha256:i=600000:salt=df24149327826839b00c3f8f34e2398e");
+      struct kdf::params argon2 = kdf::get_params("argon2id", 0, 0);
+      argon2.salt = pbkdf2.salt;
+      CHECK(kdf::to_string(argon2) == "argon2id:t=3:m=65536:p=4:salt=df24149327826839b00c3f8f34e2398e");
+      CHECK(kdf::to_string(kdf::get_params("sha256", 0, 0)) == "sha256");
+      for (const auto& p : { pbkdf2, argon2, kdf::get_params("sha256", 0, 0), kdf::get_params("argon2id", 2, 1024) })
+      {
+        const struct kdf::params& read = kdf::from_string(kdf::to_string(p));
+        CHECK((read.algorithm == p.algorithm) && (read.iterations == p.iterations) && (read.memory_kib == p.memory_kib) &&
+              (read.parallelism == p.parallelism) && (read.salt == p.salt));
+        CHECK(kdf::to_string(read) == kdf::to_string(p));
+      }
+      } },
+    { "invalid settings are rejected", []() {
+      CHECK_THROWS(kdf::get_params("md5", 0, 0));
+      CHECK_THROWS(kdf::get_params("argon2id", 0, 16));
+      for (const std::string str : { "", "md5", "pbkdf2-sha256:i=abc", "pbkdf2-sha256:salt=abc", "pbkdf2-sha256:salt=zz",
+                                     "pbkdf2-sha256:x=1", "argon2id:t=3:m" })
+        CHECK_THROWS(kdf::from_string(str));
+      } },
+    { "salts are random or derived from their seed", []() {
+      CHECK(kdf::generate_salt().size() == kdf::salt_size);
+      CHECK(kdf::generate_salt() != kdf::generate_salt());
+      CHECK(kdf::derive_salt("seed").size() == kdf::salt_size);
+      CHECK(kdf::derive_salt("seed") == kdf::derive_salt("seed"));
+      CHECK(kdf::derive_salt("seed") != kdf::derive_salt("seed2"));
+      CHECK(kdf::is_salted(kdf::get_params("pbkdf2-sha256", 0, 0)) && !kdf::is_salted(kdf::get_params("sha256", 0, 0)));
+      } },
+    { "calibration scales the pbkdf2 iterations", []() {
+      struct kdf::params p = kdf::get_params("pbkdf2-sha256", 0, 0);
+      kdf::calibrate(p, std::chrono::milliseconds(100));
+      CHECK(p.iterations >= 1);
+      struct kdf::params sha256 = kdf::get_params("sha256", 0, 0);
+      kdf::calibrate(sha256, std::chrono::milliseconds(100));
+      CHECK(sha256.iterations == 0);
+      } },
+  });
+}
@@ -0,0 +1,72 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <nlohmann/json.hpp>
+#include "bitwarden-reader.hpp"
+#include "payload.hpp"
+#include "payload-baseline.hpp"
+#include "vault-generator.hpp"
+#include "check.hpp"
+
+using json = nlohmann::ordered_json;
+
+// create random items with the characters which need to be escaped
+std::vector<struct bitwarden::item> make_items(const std::size_t nb_items)
+{
+  std::mt19937 rng(7);
+  std::vector<struct bitwarden::item> items(nb_items);
+  for (auto& item : items)
+  {
+    item.type = 1;
+    item.username = vault::details::random_string(rng, 24);
+    item.password = vault::details::random_string(rng, 32);
+    item.totp = vault::details::random_string(rng, 16);
+    for (std::size_t i = rng() % 4; i > 0; --i)
+    {
+      // never empty: the readers skip the fields without name
+      const std::string& name = fmt::format("{}{}", i, vault::details::random_string(rng, 12));
+      item.fields.push_back({ name, vault::details::random_string(rng, 24) });
+    }
+  }
+  return items;
+}
+
+int main()
+{
+  return check::run({
+    { "json writer matches the dump + regex baseline", []() {
+      payload::writer writer;
+      for (const auto& item : make_items(2000))
+        CHECK(writer.write(item) == baseline::write_payload(item));
+      } },
+    { "json writer with empty item", []() {
+      payload::writer writer;
+      const struct bitwarden::item item;
+      CHECK(writer.write(item) == baseline::write_payload(item));
+      } },
+    { "compact writer is valid json with short keys", []() {
+      payload::writer writer;
+      for (const auto& item : make_items(500))
+      {
+        const json& obj = json::parse(writer.write(item, payload::format::compact));
+        CHECK(obj["l"].value("u", "") == item.username);
+        CHECK(obj["l"].value("p", "") == item.password);
+        CHECK(obj["l"].value("t", "") == item.totp);
+        CHECK(obj.contains("f") == !item.fields.empty());
+        for (std::size_t i = 0; i < item.fields.size(); ++i)
+          CHECK(obj["f"][i][item.fields[i].name] == item.fields[i].value);
+      }
+      } },
+    { "binary writers encode the compact schema", []() {
+      payload::writer writer;
+      for (const auto& item : make_items(200))
+      {
+        const json& compact = json::parse(writer.write(item, payload::format::compact));
+        const std::string cbor = writer.write(item, payload::format::cbor);
+        CHECK(json::from_cbor(cbor) == compact);
+        const std::string msgpack = writer.write(item, payload::format::msgpack);
+        CHECK(json::from_msgpack(msgpack) == compact);
+      }
+      } },
+    });
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include "pdf-writer.hpp"
+#include "check.hpp"
+
+namespace
+{
+  // 64x64 grayscale checkerboard
+  const std::string g_png_data(
+    "\x89\x50\x4e\x47\x0d\x0a\x1a\x0a\x00\x00\x00\x0d\x49\x48\x44\x52\x00\x00\x00\x40\x00\x00\x00\x40\x08\x00\x00\x00\x00\x8f\x02\x2e"
+    "\x02\x00\x00\x00\x39\x49\x44\x41\x54\x78\xda\xed\xd4\x21\x0e\x00\x40\x08\x03\xc1\xfe\xff\xd3\x5c\x48\xb0\x88\xb3\x64\x70\x35\x23"
+    "\x10\x9b\x9a\xcb\xdc\xef\x0e\xe0\x04\xe0\x17\x80\xde\x9e\x07\xd0\x03\x80\x1e\x00\xf4\x00\xa0\x07\x00\x3d\x00\x2c\xfb\x01\xdb\x9e"
+    "\xf8\x6a\xe5\x87\x4c\x5f\x00\x00\x00\x00\x49\x45\x4e\x44\xae\x42\x60\x82", 114);
+
+  const std::filesystem::path g_tmp_dir = std::filesystem::temp_directory_path();
+
+  // read a whole file
+  std::string read_file(const std::filesystem::path& path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    CHECK(file.is_open());
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  // write a pdf of 2 pages with a footer
+  void write_pdf(const std::filesystem::path& path, const bool reproducible)
+  {
+    const qr::PngImage png{ 64, 64, g_png_data };
+    pdf::writer writer(path, 2, 2, { png }, reproducible);
+    for (int i = 0; i < 6; ++i)
+      writer.add(png);
+    writer.close();
+  }
+}
+
+int main()
+{
+  return check::run({
+    { "reproducible pdf is byte-identical across runs", []() {
+      const std::filesystem::path first = g_tmp_dir / "bw2qr-test-reproducible-1.pdf";
+      const std::filesystem::path second = g_tmp_dir / "bw2qr-test-reproducible-2.pdf";
+      write_pdf(first, true);
+      // the wall-clock dates of the two runs differ
+      std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+      write_pdf(second, true);
+      const std::string data = read_file(first);
+      CHECK(!data.empty());
+      CHECK(data == read_file(second));
+      CHECK(data.find("/ID") != std::string::npos);
+      CHECK(!std::filesystem::exists(std::filesystem::path(first).concat(".tmp")));
+      std::filesystem::remove(first);
+      std::filesystem::remove(second);
+      } },
+    { "streamed pdf replaces the existing file once complete", []() {
+      const std::filesystem::path path = g_tmp_dir / "bw2qr-test-streamed.pdf";
+      std::ofstream(path, std::ios::binary) << "previous";
+      {
+        // an interrupted document leaves the existing pdf untouched
+        const qr::PngImage png{ 64, 64, g_png_data };
+        pdf::writer writer(path, 2, 2, { png });
+        writer.add(png);
+      }
+      CHECK(read_file(path) == "previous");
+      CHECK(!std::filesystem::exists(std::filesystem::path(path).concat(".tmp")));
+      write_pdf(path, false);
+      CHECK(read_file(path).rfind("%PDF-", 0) == 0);
+      std::filesystem::remove(path);
+      } },
+  });
+}
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "pipeline.hpp"
+#include "check.hpp"
+
+int main()
+{
+  return check::run({
+    { "bounded queue keeps the order of a producer", []() {
+      pipeline::bounded_queue<int> queue(4);
+      std::thread producer([&]() {
+        for (int i = 0; i < 1000; ++i)
+          CHECK(queue.push(int(i)));
+        queue.close();
+        });
+      int expected = 0;
+      for (int value = 0; queue.pop(value); ++expected)
+        CHECK(value == expected);
+      producer.join();
+      CHECK(expected == 1000);
+      } },
+    { "bounded queue delivers every value to the consumers", []() {
+      pipeline::bounded_queue<std::size_t> queue(8);
+      std::atomic<std::size_t> sum(0);
+      std::atomic<std::size_t> count(0);
+      std::vector<std::thread> consumers(8);
+      for (auto& t : consumers)
+        t = std::thread([&]() {
+          for (std::size_t value = 0; queue.pop(value); ++count)
+            sum += value;
+          });
+      std::vector<std::thread> producers(8);
+      for (std::size_t p = 0; p < producers.size(); ++p)
+        producers[p] = std::thread([&, p]() {
+          for (std::size_t i = p; i < 10000; i += 8)
+            queue.push(std::size_t(i));
+          });
+      for (auto& t : producers)
+        t.join();
+      queue.close();
+      for (auto& t : consumers)
+        t.join();
+      CHECK(count == 10000);
+      CHECK(sum == 10000 * 9999 / 2);
+      } },
+    { "closed queue refuses values and wakes the producers", []() {
+      pipeline::bounded_queue<int> queue(1);
+      CHECK(queue.push(1));
+      std::thread producer([&]() { CHECK(!queue.push(2)); });
+      queue.close();
+      producer.join();
+      int value = 0;
+      CHECK(queue.pop(value) && (value == 1));
+      CHECK(!queue.pop(value));
+      } },
+    { "window bounds the items in flight", []() {
+      pipeline::window window(4);
+      std::atomic<std::size_t> released(0);
+      std::atomic<bool> overflow(false);
+      std::atomic<std::size_t> next(0);
+      std::vector<std::thread> threads(8);
+      std::vector<std::atomic<bool>> done(1000);
+      for (auto& t : threads)
+        t = std::thread([&]() {
+          for (std::size_t i = next++; i < done.size(); i = next++)
+          {
+            if (!window.acquire(i))
+              return;
+            if (i >= released + 4)
+              overflow = true;
+            done[i] = true;
+          }
+          });
+
+      // release the items in order like the last stage of the pipeline
+      for (std::size_t i = 0; i < done.size(); ++i)
+      {
+        while (!done[i])
+          std::this_thread::yield();
+        ++released;
+        window.release();
+      }
+      for (auto& t : threads)
+        t.join();
+      CHECK(!overflow);
+      } },
+    { "cancelled window wakes the waiting items", []() {
+      pipeline::window window(1);
+      CHECK(window.acquire(0));
+      std::thread waiting([&]() { CHECK(!window.acquire(1)); });
+      window.cancel();
+      waiting.join();
+      } },
+    });
+}
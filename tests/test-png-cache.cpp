@@ -0,0 +1,108 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "png-cache.hpp"
+#include "check.hpp"
+
+namespace
+{
+  const std::filesystem::path g_cache_dir = std::filesystem::temp_directory_path() / "bw2qr-test-png-cache";
+
+  // png signature and IHDR chunk of the given size followed by filler data - the cache only reads the header
+  struct qr::PngImage make_png(const std::size_t width, const std::size_t height, const std::size_t size = 1024)
+  {
+    std::string data("\x89PNG\r\n\x1a\n\x00\x00\x00\x0dIHDR", 16);
+    for (const std::size_t value : { width, height })
+      for (int shift = 24; shift >= 0; shift -= 8)
+        data += static_cast<char>((value >> shift) & 0xff);
+    data.resize(size, '\x2a');
+    return { width, height, data };
+  }
+
+  // create an empty cache directory
+  void reset_cache_dir()
+  {
+    std::filesystem::remove_all(g_cache_dir);
+  }
+}
+
+int main()
+{
+  return check::run({
+    { "stylesheet fingerprint depends on every option", []() {
+      const std::string& base = cache::get_fingerprint({ option::qrcode_module_px_size(3), option::frame_font_family("Arial") });
+      CHECK(base == cache::get_fingerprint({ option::qrcode_module_px_size(3), option::frame_font_family("Arial") }));
+      CHECK(base != cache::get_fingerprint({ option::qrcode_module_px_size(4), option::frame_font_family("Arial") }));
+      CHECK(base != cache::get_fingerprint({ option::qrcode_module_px_size(3), option::frame_font_family("Arial Black") }));
+      CHECK(base != cache::get_fingerprint({ option::qrcode_module_px_size(3) }));
+      } },
+    { "cache keys depend on every input", []() {
+      reset_cache_dir();
+      cache::png_cache png_cache(g_cache_dir, 1024 * 1024, "fingerprint");
+      const std::string& key = png_cache.get_key("title", "data", "url", "logo");
+      CHECK(key.size() == 64);
+      CHECK(key == png_cache.get_key("title", "data", "url", "logo"));
+      CHECK(key != png_cache.get_key("title2", "data", "url", "logo"));
+      CHECK(key != png_cache.get_key("title", "data2", "url", "logo"));
+      CHECK(key != png_cache.get_key("title", "data", "url2", "logo"));
+      CHECK(key != png_cache.get_key("title", "data", "url"));
+      CHECK(png_cache.get_key("ab", "c", "") != png_cache.get_key("a", "bc", ""));
+      CHECK(key != cache::png_cache(g_cache_dir, 1024 * 1024, "other").get_key("title", "data", "url", "logo"));
+      reset_cache_dir();
+      } },
+    { "cache round-trip keeps the image and its size", []() {
+      reset_cache_dir();
+      const struct qr::PngImage& png = make_png(300, 420);
+      {
+        cache::png_cache png_cache(g_cache_dir, 1024 * 1024, "fingerprint");
+        struct qr::PngImage loaded;
+        CHECK(!png_cache.load(png_cache.get_key("title", "data", "url"), loaded));
+        png_cache.store(png_cache.get_key("title", "data", "url"), png);
+      }
+      cache::png_cache png_cache(g_cache_dir, 1024 * 1024, "fingerprint");
+      struct qr::PngImage loaded;
+      CHECK(png_cache.load(png_cache.get_key("title", "data", "url"), loaded));
+      CHECK((loaded.width == 300) && (loaded.height == 420) && (loaded.data == png.data));
+      CHECK(!png_cache.load(png_cache.get_key("title", "data", "url", "logo"), loaded));
+      CHECK((png_cache.hits() == 1) && (png_cache.misses() == 1));
+      for (const auto& entry : std::filesystem::directory_iterator(g_cache_dir))
+        CHECK(entry.path().extension() == ".png");
+      reset_cache_dir();
+      } },
+    { "cache drops the invalid images", []() {
+      reset_cache_dir();
+      cache::png_cache png_cache(g_cache_dir, 1024 * 1024, "fingerprint");
+      const std::string& key = png_cache.get_key("title", "data", "url");
+      png_cache.store(key, { 10, 10, "not a png image" });
+      struct qr::PngImage loaded;
+      CHECK(!png_cache.load(key, loaded));
+      CHECK(!std::filesystem::exists(g_cache_dir / (key + ".png")));
+      reset_cache_dir();
+      } },
+    { "eviction removes the least recently used images", []() {
+      reset_cache_dir();
+      cache::png_cache png_cache(g_cache_dir, 3 * 1024, "fingerprint");
+      const auto now = std::filesystem::file_time_type::clock::now();
+      std::vector<std::string> keys;
+      for (int i = 0; i < 5; ++i)
+      {
+        keys.push_back(png_cache.get_key(std::to_string(i), "data", "url"));
+        png_cache.store(keys.back(), make_png(100, 100));
+        std::filesystem::last_write_time(g_cache_dir / (keys.back() + ".png"), now - std::chrono::hours(10 - i));
+      }
+
+      // loading the oldest image makes it the most recently used
+      struct qr::PngImage loaded;
+      CHECK(png_cache.load(keys[0], loaded));
+      png_cache.evict();
+      std::vector<bool> kept;
+      for (const auto& key : keys)
+        kept.push_back(std::filesystem::exists(g_cache_dir / (key + ".png")));
+      CHECK((kept == std::vector<bool>{ true, false, false, true, true }));
+      png_cache.evict();
+      CHECK(std::filesystem::exists(g_cache_dir / (keys[0] + ".png")));
+      reset_cache_dir();
+      } },
+  });
+}
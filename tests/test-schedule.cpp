@@ -0,0 +1,145 @@
+#include <set>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <fmt/format.h>
+#include <openssl/sha.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "schedule.hpp"
+#include "check.hpp"
+
+int main()
+{
+  return check::run({
+    { "thread budget uses all the cores for the entries", []() {
+      const auto budget = schedule::get_thread_budget(100, 0, 0, false, 32);
+      CHECK((budget.jobs == 32) && (budget.magick_threads == 1));
+      } },
+    { "thread budget gives the remaining cores to graphicsmagick", []() {
+      const auto budget = schedule::get_thread_budget(4, 0, 0, false, 32);
+      CHECK((budget.jobs == 4) && (budget.magick_threads == 8));
+      } },
+    { "thread budget divides the cores by the magick threads", []() {
+      const auto budget = schedule::get_thread_budget(100, 0, 4, false, 32);
+      CHECK((budget.jobs == 8) && (budget.magick_threads == 4));
+      } },
+    { "thread budget keeps the explicit jobs", []() {
+      const auto budget = schedule::get_thread_budget(100, 3, 0, false, 32);
+      CHECK((budget.jobs == 3) && (budget.magick_threads == 10));
+      } },
+    { "thread budget counts the speculative variant", []() {
+      const auto budget = schedule::get_thread_budget(100, 0, 0, true, 32);
+      CHECK((budget.jobs == 16) && (budget.magick_threads == 1));
+      const auto few = schedule::get_thread_budget(4, 0, 0, true, 32);
+      CHECK((few.jobs == 4) && (few.magick_threads == 4));
+      } },
+    { "thread budget without hardware concurrency", []() {
+      const auto budget = schedule::get_thread_budget(100, 0, 0, true, 0);
+      CHECK((budget.jobs == 1) && (budget.magick_threads == 1));
+      const auto none = schedule::get_thread_budget(0, 0, 0, false, 0);
+      CHECK((none.jobs == 1) && (none.magick_threads == 1));
+      } },
+    { "thread limit is applied by each worker", []() {
+      std::mutex mutex;
+      std::set<std::thread::id> applied;
+      schedule::thread_limit limit([&](const std::size_t nb_threads) {
+        CHECK(nb_threads == 3);
+        std::lock_guard<std::mutex> lck(mutex);
+        applied.insert(std::this_thread::get_id());
+        });
+      limit.apply();
+      CHECK(applied.empty());
+      limit.set(3);
+      std::vector<std::thread> workers(4);
+      for (auto& t : workers)
+        t = std::thread([&]() { limit.apply(); });
+      for (auto& t : workers)
+        t.join();
+      CHECK(applied.size() == workers.size());
+      } },
+#if defined(_OPENMP)
+    { "thread limit sets the OpenMP team size of the workers", []() {
+      // the setting of the main thread isn't inherited by the other threads
+      const int initial = omp_get_max_threads();
+      const std::size_t budget = static_cast<std::size_t>(initial) + 2;
+      schedule::thread_limit limit([](const std::size_t nb_threads) { omp_set_num_threads(static_cast<int>(nb_threads)); });
+      limit.set(budget);
+      limit.apply();
+      CHECK(omp_get_max_threads() == static_cast<int>(budget));
+      int unlimited = 0;
+      std::thread([&]() { unlimited = omp_get_max_threads(); }).join();
+      CHECK(unlimited == initial);
+      std::vector<int> team_sizes(4, 0);
+      std::vector<std::thread> workers(team_sizes.size());
+      for (std::size_t w = 0; w < workers.size(); ++w)
+        workers[w] = std::thread([&, w]() {
+          limit.apply();
+          #pragma omp parallel
+          {
+            #pragma omp single
+            team_sizes[w] = omp_get_num_threads();
+          }
+          });
+      for (auto& t : workers)
+        t.join();
+      for (const int size : team_sizes)
+        CHECK(size == static_cast<int>(budget));
+      omp_set_num_threads(initial);
+      } },
+#endif
+    { "lpt dispatch sorts the costs within blocks", []() {
+      const std::vector<double> costs = { 1, 3, 2, 5, 4, 0 };
+      CHECK((schedule::get_dispatch_order(costs, 3, schedule::policy::lpt) == std::vector<std::size_t>{ 1, 2, 0, 3, 4, 5 }));
+      CHECK((schedule::get_dispatch_order(costs, 3, schedule::policy::fifo) == std::vector<std::size_t>{ 0, 1, 2, 3, 4, 5 }));
+      } },
+    { "history is keyed by the per-install secret", []() {
+      const std::filesystem::path dir = std::filesystem::temp_directory_path() / "bw2qr-test-schedule";
+      std::filesystem::remove_all(dir);
+      const std::filesystem::path history = dir / "history.json";
+      const std::filesystem::path key_file = dir / "install" / "schedule-history.key";
+      bitwarden::item item;
+      item.name = "bank";
+      item.uri = "https://bank.example";
+      {
+        schedule::cost_model model(history, false, false, key_file);
+        model.update(item, 2.0);
+        model.save();
+      }
+      CHECK(std::filesystem::file_size(key_file) == 32);
+
+      // the plain SHA-256 of the name and url isn't in the history
+      const std::string str = "4:bank;20:https://bank.example;";
+      unsigned char digest[SHA256_DIGEST_LENGTH];
+      SHA256(reinterpret_cast<const unsigned char*>(str.data()), str.size(), digest);
+      std::string hash;
+      for (const auto& byte : digest)
+        hash += fmt::format("{:02x}", byte);
+      std::ifstream file(history, std::ios::binary);
+      const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      CHECK(!data.empty() && (data.find(hash) == std::string::npos));
+
+      // the durations are only found with the same secret
+      {
+        schedule::cost_model model(history, false, false, key_file);
+        CHECK(model.get_costs({ item }, { 0 }) == std::vector<double>{ 2.0 });
+      }
+      {
+        schedule::cost_model model(history, false, false, dir / "other.key");
+        CHECK(model.get_costs({ item }, { 0 }) != std::vector<double>{ 2.0 });
+      }
+      file.close();
+      std::filesystem::remove_all(dir);
+      } },
+    { "ideal makespan is bound by the longest job", []() {
+      CHECK(schedule::get_ideal_makespan({ 1, 1, 1, 1 }, 2) == 2.0);
+      CHECK(schedule::get_ideal_makespan({ 5, 1, 1, 1 }, 4) == 5.0);
+      CHECK(schedule::get_ideal_makespan({}, 4) == 0.0);
+      } },
+    });
+}
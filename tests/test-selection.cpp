@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include "selection.hpp"
+#include "check.hpp"
+
+using json = nlohmann::ordered_json;
+
+// item with its header properties
+struct bitwarden::item make_item(const std::string& name,
+                                 const int type,
+                                 const bool favorite,
+                                 const std::string& folder_id = "",
+                                 const std::vector<std::string>& collection_ids = {},
+                                 const std::string& organization_id = "")
+{
+  struct bitwarden::item item;
+  item.name = name;
+  item.type = type;
+  item.favorite = favorite;
+  item.folder_id = folder_id;
+  item.collection_ids = collection_ids;
+  item.organization_id = organization_id;
+  return item;
+}
+
+// export with its folders and collections before or after the items
+std::string make_export(const bool names_first)
+{
+  const json folders = json::parse(R"([{ "id": "f1", "name": "Work" }, { "id": "f2", "name": "Personal" }])");
+  const json collections = json::parse(R"([{ "id": "c1", "name": "Team" }])");
+  const json items = json::parse(R"([
+    { "name": "bank", "type": 1, "favorite": false, "folderId": "f2", "login": { "username": "u1" } },
+    { "name": "mail", "type": 1, "favorite": false, "folderId": "f1", "login": { "username": "u2" } },
+    { "name": "wiki", "type": 1, "favorite": false, "folderId": null, "collectionIds": [ "c1" ], "login": { "username": "u3" } },
+    { "name": "card", "type": 3, "favorite": false, "folderId": "f1" }
+  ])");
+  json root = json::object();
+  root["encrypted"] = false;
+  if (names_first)
+  {
+    root["folders"] = folders;
+    root["collections"] = collections;
+  }
+  root["items"] = items;
+  if (!names_first)
+  {
+    root["folders"] = folders;
+    root["collections"] = collections;
+  }
+  return root.dump();
+}
+
+// select the names of the items like bw2qr: index the header, then filter again once the export is read
+std::vector<std::string> select_names(const std::string& data, const std::string& expression, const bitwarden::backend parser)
+{
+  selection::filter filter(expression);
+  std::vector<struct bitwarden::item> items;
+  const json& root = bitwarden::parse(data, data.size(), parser,
+    [&](const struct bitwarden::item& item) { return filter(item); },
+    [&](struct bitwarden::item&& item) { items.push_back(std::move(item)); },
+    [&](const json& header) { filter.index(header, nullptr, false); });
+  if (!filter.indexed())
+  {
+    filter.index(root);
+    items.erase(std::remove_if(items.begin(), items.end(), [&](const struct bitwarden::item& item) { return !filter(item); }), items.end());
+  }
+  std::vector<std::string> names;
+  for (const auto& item : items)
+    names.push_back(item.name);
+  return names;
+}
+
+// json parsers built in the program
+std::vector<bitwarden::backend> get_backends()
+{
+  std::vector<bitwarden::backend> backends = { bitwarden::backend::nlohmann };
+#ifdef BW2QR_WITH_SIMDJSON
+  backends.push_back(bitwarden::backend::simdjson);
+#endif
+  return backends;
+}
+
+int main()
+{
+  return check::run({
+    { "filter rejects invalid expressions", []() {
+      for (const std::string expression : { "type", "=login", "color=red", "type=foo", "type=", "favorite=maybe",
+                                            "favorite=true|false", "type~log", "favorite~true", "name~(", "name!login" })
+        CHECK_THROWS(selection::filter filter(expression));
+      } },
+    { "filter matches the header properties", []() {
+      const auto bank = make_item("bank", 1, true, "", {}, "org1");
+      const auto note = make_item("notes", 2, false);
+      const auto card = make_item("card", 3, true);
+      CHECK(selection::filter("")(note));
+      CHECK(selection::filter("type=login|card")(bank) && selection::filter("type=login|card")(card));
+      CHECK(!selection::filter("type=login|card")(note));
+      CHECK(selection::filter("type=2")(note) && selection::filter("type!=login")(note));
+      CHECK(selection::filter("favorite=true")(card) && !selection::filter("favorite=true")(note));
+      CHECK(selection::filter("organization=org1")(bank) && !selection::filter("organization=org1")(card));
+      CHECK(selection::filter("organization=")(card) && selection::filter("organization~^org")(bank));
+      CHECK(selection::filter("name~^ba")(bank) && !selection::filter("name~^ba")(card));
+      CHECK(selection::filter("name=notes|card")(note) && !selection::filter("name!=notes")(note));
+      CHECK(selection::filter(";type=login;;favorite=true;")(bank));
+      CHECK(!selection::filter("type=login;favorite=false")(bank));
+      } },
+    { "filter resolves the folders and collections names", []() {
+      const json& root = json::parse(make_export(true));
+      selection::filter work("folder=Work");
+      work.index(root);
+      CHECK(work.indexed());
+      CHECK(work(make_item("mail", 1, false, "f1")) && !work(make_item("bank", 1, false, "f2")));
+      selection::filter none("folder=|Personal");
+      none.index(root);
+      CHECK(none(make_item("wiki", 1, false)) && none(make_item("bank", 1, false, "f2")) && !none(make_item("mail", 1, false, "f1")));
+      selection::filter pattern("folder~^Per;collection!=Team");
+      pattern.index(root);
+      CHECK(pattern(make_item("bank", 1, false, "f2")) && !pattern(make_item("bank", 1, false, "f2", { "c1" })));
+      selection::filter team("collection=Team");
+      team.index(root);
+      CHECK(team(make_item("wiki", 1, false, "", { "c9", "c1" })) && !team(make_item("wiki", 1, false)));
+      selection::filter unknown("folder=Finance");
+      CHECK_THROWS(unknown.index(root));
+      } },
+    { "filter defers the folders listed after the items", []() {
+      const json& root = json::parse(make_export(false));
+      selection::filter work("type=login;folder=Work");
+      work.index(json::object(), nullptr, false);
+      CHECK(!work.indexed());
+      CHECK(work(make_item("bank", 1, false, "f2")) && !work(make_item("card", 3, false, "f1")));
+      work.index(root);
+      CHECK(work.indexed() && !work(make_item("bank", 1, false, "f2")));
+      selection::filter missing("folder=Work");
+      CHECK_THROWS(missing.index(json::object()));
+      } },
+    { "selection doesn't depend on the order of the keys", []() {
+      for (const auto parser : get_backends())
+        for (const std::string expression : { "folder=Work", "folder!=Work;type=login", "collection=Team", "folder=", "type=login;name~a" })
+        {
+          const std::vector<std::string>& expected = select_names(make_export(true), expression, parser);
+          CHECK(select_names(make_export(false), expression, parser) == expected);
+        }
+      CHECK((select_names(make_export(false), "folder=Work", bitwarden::backend::nlohmann) == std::vector<std::string>{ "mail", "card" }));
+      CHECK((select_names(make_export(false), "type=login;folder!=Work", bitwarden::backend::nlohmann) == std::vector<std::string>{ "bank", "wiki" }));
+      CHECK_THROWS(select_names(make_export(false), "folder=Finance", bitwarden::backend::nlohmann));
+      } },
+  });
+}
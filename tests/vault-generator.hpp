@@ -0,0 +1,97 @@
+#pragma once
+#include <string>
+#include <random>
+#include <cstdint>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+namespace vault
+{
+  using json = nlohmann::ordered_json;
+
+  namespace details
+  {
+    // random string with the characters which need to be escaped in json
+    inline std::string random_string(std::mt19937& rng, const std::size_t max_size)
+    {
+      static const std::string chars[] = {
+        "a", "b", "z", "A", "Z", "0", "9", " ", "-", "_", "@", ".", "/", ":",
+        "\"", "\\", "\n", "\t", "\r", "\b", "\f", "\x01", "\x1f",
+        "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x94\x91" };
+      std::string str;
+      const std::size_t size = std::uniform_int_distribution<std::size_t>(0, max_size)(rng);
+      for (std::size_t i = 0; i < size; ++i)
+        str += chars[std::uniform_int_distribution<std::size_t>(0, std::size(chars) - 1)(rng)];
+      return str;
+    }
+
+    // random value of an optional string field: a string, an empty string, null or missing
+    inline void add_field(json& obj, const std::string& name, std::mt19937& rng, const std::size_t max_size)
+    {
+      switch (std::uniform_int_distribution<int>(0, 9)(rng))
+      {
+      case 0:  break;
+      case 1:  obj[name] = nullptr; break;
+      case 2:  obj[name] = ""; break;
+      default: obj[name] = random_string(rng, max_size); break;
+      }
+    }
+  }
+
+  // create a synthetic bitwarden item: logins, notes, cards and identities
+  inline json make_item(std::mt19937& rng, const std::size_t index, const std::size_t notes_size = 0)
+  {
+    json item;
+    item["id"] = fmt::format("{:08x}-0000-0000-0000-{:012x}", static_cast<std::uint32_t>(rng()), index);
+    item["organizationId"] = nullptr;
+    item["folderId"] = (rng() % 4) ? json(nullptr) : json(fmt::format("folder-{}", rng() % 8));
+    item["type"] = (rng() % 10 < 7) ? 1 : static_cast<int>(2 + rng() % 3);
+    item["name"] = fmt::format("item {} {}", index, details::random_string(rng, 16));
+    item["notes"] = notes_size ? json(std::string(notes_size, 'n')) : json(nullptr);
+    item["favorite"] = (rng() % 3) == 0;
+    if (item["type"] == 1)
+    {
+      json login = json::object();
+      if (rng() % 5)
+      {
+        login["uris"] = json::array();
+        for (std::size_t i = rng() % 3; i > 0; --i)
+          login["uris"].push_back({ { "match", nullptr }, { "uri", fmt::format("https://site-{}.example.com/login", rng() % 1000) } });
+      }
+      details::add_field(login, "username", rng, 24);
+      details::add_field(login, "password", rng, 32);
+      details::add_field(login, "totp", rng, 16);
+      item["login"] = login;
+    }
+    if (rng() % 2)
+    {
+      item["fields"] = json::array();
+      for (std::size_t i = rng() % 4; i > 0; --i)
+      {
+        json field;
+        details::add_field(field, "name", rng, 12);
+        details::add_field(field, "value", rng, 24);
+        field["type"] = 0;
+        item["fields"].push_back(field);
+      }
+    }
+    item["collectionIds"] = nullptr;
+    return item;
+  }
+
+  // create a synthetic bitwarden json export of at least min_size bytes or nb_items items
+  inline std::string make_export(const std::size_t nb_items, const std::uint32_t seed = 42, const std::size_t min_size = 0, const std::size_t notes_size = 0)
+  {
+    std::mt19937 rng(seed);
+    std::string data = "{\"encrypted\":false,\"folders\":[],\"items\":[";
+    for (std::size_t i = 0; (i < nb_items) || (data.size() < min_size); ++i)
+    {
+      if (i)
+        data += ',';
+      data += make_item(rng, i, notes_size).dump();
+    }
+    data += "]}";
+    return data;
+  }
+}